@@ -76,7 +76,7 @@ void reportError(const std::source_location location = std::source_location::cur
 }
 #endif
 
-struct Helper : event_emitter_util<events::tempo_changed> {
+struct Helper : flat_event_emitter<events::tempo_changed> {
     void operator()(auto&&, const foreign_midi_message& msg)
     {
         // std::println("{}", dump_span(msg.data(), msg.size()));
@@ -214,6 +214,9 @@ int main(int argc, char** argv)
     };
     using thefilter = delta_timed_filter_view<std::ranges::owning_view<span_track>, decltype(filter_meta)>;
     using therange  = std::ranges::subrange<std::ranges::iterator_t<thefilter>, std::ranges::sentinel_t<thefilter>>;
+    auto      loaded = load_smf_parallel(mmap_span);
+    tempo_map tempos{loaded.info.division, loaded.tempo_events};
+
     track_playhead_group<therange, Helper> player; // init player after everything
     using Playhead = decltype(player)::Playhead;
 
@@ -234,16 +237,11 @@ int main(int argc, char** argv)
     }
 
     player.set_division(rop.info.division);
+    player.set_tempo_map(&tempos);
+    player.build_seek_cache(1s);
 
     // manual init player thread to set priority
-    player.init_thread();
-    // #if defined(_POSIX_THREADS)
-    //     sched_param para{};
-    //     para.sched_priority = (sched_get_priority_max(SCHED_FIFO) + sched_get_priority_min(SCHED_FIFO)) / 2;
-    //     pthread_setschedparam(player.thread_native_handle(), SCHED_FIFO, &para);
-    // #else
-    //     SetThreadPriority(player.thread_native_handle(), THREAD_PRIORITY_TIME_CRITICAL);
-    // #endif
+    player.init_thread({.policy = player_thread_options::scheduling_policy::fifo, .lock_memory = true, .prefault_stack = 256 * 1024});
 
     std::vector<std::string> splitedcmd;
     std::getchar();
@@ -262,12 +260,10 @@ int main(int argc, char** argv)
             if (player.empty()) {
                 std::println("EOF");
             } else {
-                sendAllSoundsOff(dev);
                 player.play();
             }
         } else if (splitedcmd[0] == "pause") {
-            player.pause();
-            sendAllSoundsOff(dev);
+            player.pause(); // the player releases its notes
         } else if (splitedcmd[0] == "seek") {
             if (splitedcmd.size() < 2) {
                 decltype(player)::Time pos;
@@ -283,15 +279,15 @@ int main(int argc, char** argv)
                 std::println("Current time: {}:{}:{}", hms.hours(), hms.minutes(), hms.seconds());
                 continue;
             }
-            sendAllSoundsOff(dev);
             std::chrono::nanoseconds target{std::chrono::seconds{std::stoll(splitedcmd[1])}};
             std::println("Seeking to {}", target);
+            std::vector<std::unique_ptr<Playhead>> heads;
             {
                 std::lock_guard guard{mutex};
-                for (auto& head : removed_playheads) {
-                    player.add_playhead(std::move(head));
-                }
-                removed_playheads.clear();
+                heads.swap(removed_playheads);
+            }
+            for (auto& head : heads) {
+                player.add_playhead(std::move(head)); // waits for the player thread, which takes mutex to remove playheads
             }
             try {
                 player.seek(target);
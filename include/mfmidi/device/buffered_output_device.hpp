@@ -0,0 +1,242 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "mfmidi/midi_device.hpp"
+#include "mfmidi/spsc_ring.hpp"
+#include "mfmidi/timingapi.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace mfmidi {
+    /// \brief Output stage which sends messages to another device on its own thread
+    ///
+    /// send_msg() only copies the message into a lock-free ring, so a blocking
+    /// backend does not delay the timing thread. Only one thread may call send_msg().
+    /// Messages longer than a ring slot (sysex) take several consecutive slots.
+    class buffered_output_device : public midi_device {
+    public:
+        using Time = std::chrono::nanoseconds;
+
+        struct statistics {
+            size_t   capacity;    ///< in slots
+            size_t   high_water;  ///< most slots in use at once
+            uint64_t queued;      ///< messages accepted by send_msg
+            uint64_t dropped;     ///< messages rejected because the ring was full
+            uint64_t sent;        ///< messages sent to the target
+            uint64_t failed;      ///< messages the target failed to send
+            Time     max_latency; ///< longest time a message stayed in the ring
+        };
+
+        /// \param target Device which sends the messages, must outlive this
+        /// \param capacity Ring size in slots of \c slot_size bytes
+        explicit buffered_output_device(midi_device& target, size_t capacity = 4096)
+            : _target(&target)
+            , _ring(capacity)
+            , _thread([this](const std::stop_token& stop) { sender(stop); })
+        {
+        }
+
+        ~buffered_output_device() noexcept override
+        {
+            _thread.request_stop();
+            wake();
+        }
+
+        buffered_output_device(buffered_output_device&&)                 = delete;
+        buffered_output_device& operator=(buffered_output_device&&)      = delete;
+        buffered_output_device(const buffered_output_device&)            = delete;
+        buffered_output_device& operator=(const buffered_output_device&) = delete;
+
+        bool open() override
+        {
+            return _target->open();
+        }
+
+        /// \brief Flush then close the target
+        bool close() override
+        {
+            flush();
+            return _target->close();
+        }
+
+        [[nodiscard]] bool is_open() const noexcept override
+        {
+            return _target->is_open();
+        }
+
+        [[nodiscard]] constexpr bool input_available() const noexcept override
+        {
+            return false;
+        }
+
+        [[nodiscard]] constexpr bool output_available() const noexcept override
+        {
+            return true;
+        }
+
+        std::expected<void, const char*> send_msg(std::span<const uint8_t> msg) noexcept override
+        {
+            auto result = push(msg);
+            wake();
+            return result;
+        }
+
+        /// \brief Queue every message, then wake the sender once
+        std::expected<void, const char*> send_batch(std::span<const message_ref> msgs) noexcept override
+        {
+            std::expected<void, const char*> result;
+            for (message_ref msg : msgs) {
+                auto queued = push(msg);
+                if (!queued && result) {
+                    result = queued;
+                }
+            }
+            wake();
+            return result;
+        }
+
+        /// \brief Block until every queued message is handed to the target
+        void flush() const noexcept
+        {
+            const uint64_t queued = _queued.load(std::memory_order_acquire);
+            for (uint64_t done = _done.load(std::memory_order_acquire); done < queued; done = _done.load(std::memory_order_acquire)) {
+                _done.wait(done, std::memory_order_acquire);
+            }
+        }
+
+        [[nodiscard]] statistics stats() const noexcept
+        {
+            return {
+                .capacity    = _ring.capacity(),
+                .high_water  = _ring.high_water_mark(),
+                .queued      = _queued.load(std::memory_order_relaxed),
+                .dropped     = _dropped.load(std::memory_order_relaxed),
+                .sent        = _sent.load(std::memory_order_relaxed),
+                .failed      = _failed.load(std::memory_order_relaxed),
+                .max_latency = Time{_max_latency.load(std::memory_order_relaxed)},
+            };
+        }
+
+        void reset_high_water_mark() noexcept
+        {
+            _ring.reset_high_water_mark();
+            _max_latency.store(0, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] midi_device& target() const noexcept
+        {
+            return *_target;
+        }
+
+        static constexpr size_t slot_size = 21; // slots are 32 bytes
+
+    private:
+        struct slot {
+            Time                           timestamp{};
+            uint8_t                        size{};
+            bool                           continued{};
+            std::array<uint8_t, slot_size> data{};
+        };
+
+        midi_device*    _target;
+        spsc_ring<slot> _ring;
+
+        std::atomic<uint32_t> _signal{0};
+        std::atomic<uint64_t> _queued{0};
+        std::atomic<uint64_t> _done{0}; // sent or failed
+        std::atomic<uint64_t> _dropped{0};
+        std::atomic<uint64_t> _sent{0};
+        std::atomic<uint64_t> _failed{0};
+        std::atomic<int64_t>  _max_latency{0};
+
+        std::jthread _thread; // last, it uses everything above
+
+        std::expected<void, const char*> push(std::span<const uint8_t> msg) noexcept
+        {
+            const size_t slots = std::max<size_t>((msg.size() + slot_size - 1) / slot_size, 1);
+            if (_ring.free_space() < slots) {
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+                return std::unexpected{"buffered_output_device: ring is full"};
+            }
+            slot   part{.timestamp = hiresticktime()};
+            size_t offset = 0;
+            do {
+                part.size      = static_cast<uint8_t>(std::min(msg.size() - offset, slot_size));
+                part.continued = offset + part.size < msg.size();
+                std::copy_n(msg.data() + offset, part.size, part.data.data());
+                _ring.try_push(part);
+                offset += part.size;
+            } while (part.continued);
+            _queued.fetch_add(1, std::memory_order_release);
+            return {};
+        }
+
+        void wake() noexcept
+        {
+            _signal.fetch_add(1, std::memory_order_release);
+            _signal.notify_one();
+        }
+
+        void sender(const std::stop_token& stop)
+        {
+            std::vector<uint8_t> assembled;
+            slot                 part;
+            while (true) {
+                const uint32_t seen = _signal.load(std::memory_order_acquire);
+                while (_ring.try_pop(part)) {
+                    if (part.continued || !assembled.empty()) {
+                        assembled.insert(assembled.end(), part.data.begin(), part.data.begin() + part.size);
+                        if (part.continued) {
+                            continue;
+                        }
+                        deliver(assembled, part.timestamp);
+                        assembled.clear();
+                    } else {
+                        deliver({part.data.data(), part.size}, part.timestamp);
+                    }
+                }
+                if (stop.stop_requested()) {
+                    return;
+                }
+                _signal.wait(seen, std::memory_order_acquire);
+            }
+        }
+
+        void deliver(std::span<const uint8_t> msg, Time timestamp)
+        {
+            if (_target->send_msg(msg)) {
+                _sent.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                _failed.fetch_add(1, std::memory_order_relaxed);
+            }
+            const int64_t latency = (hiresticktime() - timestamp).count();
+            if (latency > _max_latency.load(std::memory_order_relaxed)) {
+                _max_latency.store(latency, std::memory_order_relaxed);
+            }
+            _done.fetch_add(1, std::memory_order_release);
+            _done.notify_all();
+        }
+    };
+}
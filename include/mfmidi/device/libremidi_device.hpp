@@ -23,6 +23,7 @@
 #include <string>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 namespace mfmidi {
 #pragma region rtmidi
@@ -165,10 +166,44 @@ namespace mfmidi {
             return {};
         }
 
+        /// \brief Messages after a failed one are still sent, the first error is returned
+        ///
+        /// On ALSA_RAW the batch is one write. It is not retried if it fails, since part
+        /// of it may already be out and would be sent twice.
+        std::expected<void, const char*> send_batch(std::span<const message_ref> msgs) noexcept override
+        {
+            try {
+                if (min.get_current_api() == libremidi::API::ALSA_RAW) { // byte stream, one write for everything
+                    mbatch.clear();
+                    for (message_ref msg : msgs) {
+                        mbatch.insert(mbatch.end(), msg.begin(), msg.end());
+                    }
+                    min.send_message(mbatch);
+                    return {};
+                }
+            } catch (std::exception& err) {
+                return std::unexpected{err.what()};
+            }
+
+            // other backends take one message per call
+            std::expected<void, const char*> result;
+            for (message_ref msg : msgs) {
+                try {
+                    min.send_message(msg);
+                } catch (std::exception& err) {
+                    if (result) {
+                        result = std::unexpected{err.what()};
+                    }
+                }
+            }
+            return result;
+        }
+
     private:
         libremidi::midi_out    min;
         libremidi::output_port mid{};
         std::string            mnm;
         bool                   mvirtual = false;
+        std::vector<uint8_t>   mbatch;
     };
 }
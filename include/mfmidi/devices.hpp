@@ -21,4 +21,5 @@
 #include "mfmidi/device/kdmapi_device.hpp"
 #endif
 
+#include "mfmidi/device/buffered_output_device.hpp"
 #include "mfmidi/device/libremidi_device.hpp"
@@ -1,11 +1,16 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <concepts>
 #include <functional>
 #include <ranges>
+#include <tuple>
 #include <type_traits>
 #include <unordered_map>
+#include <utility>
 #include <variant>
+#include <vector>
 
 namespace mfmidi {
     template <class T>
@@ -82,4 +87,165 @@ namespace mfmidi {
         std::size_t                                                                        counter{};
         std::unordered_multimap<std::size_t, std::variant<std::function<void(Events)>...>> handlers;
     };
+
+    namespace details {
+        /// \brief Handlers of one event type, the first \a N are stored in the list without allocating
+        template <class Ev, std::size_t N>
+        class handler_list {
+        public:
+            using function = std::function<void(const Ev&)>;
+
+            void add(std::size_t id, function func)
+            {
+                if (_inline_size < N) {
+                    _inline[_inline_size++] = {id, std::move(func)};
+                } else {
+                    _overflow.push_back({id, std::move(func)});
+                }
+            }
+
+            /// \brief Keeps the order of other handlers
+            void remove(std::size_t id)
+            {
+                auto inline_end = _inline.begin() + _inline_size;
+                if (auto found = std::ranges::find(_inline.begin(), inline_end, id, &entry::id); found != inline_end) {
+                    std::move(found + 1, inline_end, found);
+                    if (_overflow.empty()) {
+                        _inline[--_inline_size] = {};
+                    } else {
+                        _inline[_inline_size - 1] = std::move(_overflow.front());
+                        _overflow.erase(_overflow.begin());
+                    }
+                    return;
+                }
+                std::erase_if(_overflow, [id](const entry& ent) { return ent.id == id; });
+            }
+
+            void operator()(const Ev& ev) const
+            {
+                for (std::size_t i = 0; i < _inline_size; ++i) {
+                    _inline[i].func(ev);
+                }
+                for (const entry& ent : _overflow) {
+                    ent.func(ev);
+                }
+            }
+
+            [[nodiscard]] std::size_t size() const noexcept
+            {
+                return _inline_size + _overflow.size();
+            }
+
+        private:
+            struct entry {
+                std::size_t id{};
+                function    func;
+            };
+
+            std::array<entry, N> _inline{};
+            std::size_t          _inline_size{};
+            std::vector<entry>   _overflow;
+        };
+    }
+
+    /// \brief Event emitter with one flat handler list per event type
+    ///
+    /// emit() only walks the handlers of the emitted type and calls them directly,
+    /// the list of every type stores its first \a InlineHandlers handlers inline.
+    /// Handlers are still held by std::function, which allocates for captures larger
+    /// than its small buffer (a few pointers).
+    template <std::size_t InlineHandlers, class... Events>
+        requires(sizeof...(Events) > 0)
+    class basic_flat_event_emitter {
+    public:
+        struct token {
+            std::size_t _id;
+            friend bool operator==(const token& lhs, const token& rhs) noexcept = default;
+        };
+
+        token add_event_handler(auto handler)
+        {
+            static_assert((event_handler<decltype(handler), Events> || ...), "handler must satisfy at least one event type's constraints");
+            auto try_event_type = [this]<class Ev>(auto& handler) {
+                if constexpr (event_handler<decltype(handler), Ev>) {
+                    list<Ev>().add(_counter, handler);
+                }
+            };
+            (try_event_type.template operator()<Events>(handler), ...);
+            return token{_counter++};
+        }
+
+        void remove_event_handler(token tok)
+        {
+            (list<Events>().remove(tok._id), ...);
+        }
+
+        template <event Ev>
+        void emit(const Ev& ev) const
+        {
+            static_assert((std::same_as<Ev, Events> || ...), "cannot emit event of type that is not in Events list");
+            std::get<details::handler_list<Ev, InlineHandlers>>(_handlers)(ev);
+        }
+
+        template <event Ev>
+        [[nodiscard]] std::size_t handler_count() const noexcept
+        {
+            return std::get<details::handler_list<Ev, InlineHandlers>>(_handlers).size();
+        }
+
+    private:
+        template <class Ev>
+        details::handler_list<Ev, InlineHandlers>& list() noexcept
+        {
+            return std::get<details::handler_list<Ev, InlineHandlers>>(_handlers);
+        }
+
+        std::size_t                                                  _counter{};
+        std::tuple<details::handler_list<Events, InlineHandlers>...> _handlers;
+    };
+
+    template <class... Events>
+    using flat_event_emitter = basic_flat_event_emitter<4, Events...>;
+
+    /// \brief Event emitter whose handlers are fixed at compile time
+    ///
+    /// emit() calls every handler invocable with the event directly, so it can be
+    /// inlined completely. Handlers cannot be added at runtime, therefore players
+    /// do not subscribe to it and need a tempo map.
+    template <class... Handlers>
+    class static_event_emitter {
+    public:
+        constexpr static_event_emitter() = default;
+
+        constexpr explicit static_event_emitter(Handlers... handlers)
+            : _handlers(std::move(handlers)...)
+        {
+        }
+
+        template <event Ev>
+        constexpr void emit(const Ev& ev)
+        {
+            static_assert((std::invocable<Handlers&, const Ev&> || ...), "no handler accepts this event type");
+            std::apply(
+                [&ev](auto&... handler) {
+                    auto call = [&ev](auto& func) {
+                        if constexpr (std::invocable<decltype(func), const Ev&>) {
+                            std::invoke(func, ev);
+                        }
+                    };
+                    (call(handler), ...);
+                },
+                _handlers
+            );
+        }
+
+        template <std::size_t I>
+        [[nodiscard]] constexpr auto& handler() noexcept
+        {
+            return std::get<I>(_handlers);
+        }
+
+    private:
+        std::tuple<Handlers...> _handlers;
+    };
 }
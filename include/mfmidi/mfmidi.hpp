@@ -5,14 +5,21 @@
 #include "mfmidi/mfutility.hpp"
 
 // midi
+#include "mfmidi/midi_active_notes.hpp"
+#include "mfmidi/midi_chase.hpp"
 #include "mfmidi/midi_events.hpp"
 #include "mfmidi/midi_message.hpp"
+#include "mfmidi/midi_port_router.hpp"
 #include "mfmidi/midi_status.hpp"
 #include "mfmidi/midi_tempo.hpp"
 #include "mfmidi/midi_utility.hpp"
+#include "mfmidi/mpsc_queue.hpp"
+#include "mfmidi/spsc_ring.hpp"
 
 #include "mfmidi/midi_ranges.hpp"
 
+#include "mfmidi/playback_clock.hpp"
+#include "mfmidi/player_metrics.hpp"
 #include "mfmidi/timingapi.hpp"
 #include "mfmidi/track_player.hpp"
 
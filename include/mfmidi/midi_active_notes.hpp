@@ -0,0 +1,139 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/// \file midi_active_notes.hpp
+/// \brief Track sounding notes to release them
+
+#pragma once
+
+#include "mfmidi/midi_device.hpp"
+#include "mfmidi/midi_utility.hpp"
+
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace mfmidi {
+    /// \brief Sounding notes of 16 channels, one bit per note
+    ///
+    /// Feed it every sent message, then release() sends a note off for exactly the
+    /// notes which are still on. Unlike All Sound Off it keeps release and reverb
+    /// tails, and works on devices ignoring channel mode messages.
+    class active_note_map {
+    public:
+        /// \brief Update from \a msg, other than note on and off are ignored
+        constexpr void process(std::span<const uint8_t> msg) noexcept
+        {
+            if (msg.size() < 3) {
+                return;
+            }
+            const uint8_t  kind    = msg[0] & 0xF0U;
+            const uint64_t on      = kind == MIDIMsgStatus::NOTE_ON && msg[2] != 0;
+            const uint64_t touched = on | static_cast<uint64_t>(kind == MIDIMsgStatus::NOTE_OFF || kind == MIDIMsgStatus::NOTE_ON);
+            const uint8_t  note    = msg[1] & 0x7FU;
+            uint64_t&      word    = _bits[msg[0] & 0x0FU][note >> 6U];
+            const unsigned bit     = note & 63U;
+            word                   = (word & ~(touched << bit)) | (on << bit);
+        }
+
+        [[nodiscard]] constexpr bool test(uint8_t channel, uint8_t note) const noexcept
+        {
+            return ((_bits[channel & 0x0FU][(note & 0x7FU) >> 6U] >> (note & 63U)) & 1U) != 0;
+        }
+
+        constexpr void set(uint8_t channel, uint8_t note, bool on) noexcept
+        {
+            uint64_t&      word = _bits[channel & 0x0FU][(note & 0x7FU) >> 6U];
+            const uint64_t mask = uint64_t{1} << (note & 63U);
+            word                = on ? word | mask : word & ~mask;
+        }
+
+        /// \brief Count of sounding notes
+        [[nodiscard]] constexpr size_t count() const noexcept
+        {
+            size_t result = 0;
+            for (const auto& channel : _bits) {
+                result += std::popcount(channel[0]) + std::popcount(channel[1]);
+            }
+            return result;
+        }
+
+        [[nodiscard]] constexpr bool empty() const noexcept
+        {
+            for (const auto& channel : _bits) {
+                if ((channel[0] | channel[1]) != 0) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        constexpr void clear() noexcept
+        {
+            _bits = {};
+        }
+
+        /// \brief Add notes of \a other
+        constexpr void merge(const active_note_map& other) noexcept
+        {
+            for (size_t channel = 0; channel < _bits.size(); ++channel) {
+                _bits[channel][0] |= other._bits[channel][0];
+                _bits[channel][1] |= other._bits[channel][1];
+            }
+        }
+
+        /// \brief Call \c f(std::span<const uint8_t>) with a note off of every sounding note
+        template <std::invocable<std::span<const uint8_t>> F>
+        constexpr void emit(F&& f) const
+        {
+            for (uint8_t channel = 0; channel < _bits.size(); ++channel) {
+                for (uint8_t half = 0; half < 2; ++half) {
+                    for (uint64_t word = _bits[channel][half]; word != 0; word &= word - 1) {
+                        const uint8_t msg[]{static_cast<uint8_t>(MIDIMsgStatus::NOTE_OFF | channel), static_cast<uint8_t>(half * 64 + std::countr_zero(word)), 0x40};
+                        f(std::span<const uint8_t>{msg});
+                    }
+                }
+            }
+        }
+
+        /// \brief Send note offs of every sounding note to \a dev with a single send_batch, then clear
+        /// \return Count of messages, 0 if the device failed
+        size_t release(midi_device& dev)
+        {
+            std::vector<uint8_t> bytes;
+            bytes.reserve(count() * 3);
+            emit([&](std::span<const uint8_t> msg) { bytes.insert(bytes.end(), msg.begin(), msg.end()); });
+            clear();
+            if (bytes.empty()) {
+                return 0;
+            }
+
+            std::vector<message_ref> msgs;
+            msgs.reserve(bytes.size() / 3);
+            for (size_t begin = 0; begin < bytes.size(); begin += 3) {
+                msgs.emplace_back(bytes.data() + begin, 3);
+            }
+            return dev.send_batch(msgs) ? msgs.size() : 0;
+        }
+
+    private:
+        std::array<std::array<uint64_t, 2>, 16> _bits{};
+    };
+}
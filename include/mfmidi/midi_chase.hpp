@@ -0,0 +1,389 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/// \file midi_chase.hpp
+/// \brief Reconstruct channel state after seeking
+
+#pragma once
+
+#include "mfmidi/midi_device.hpp"
+#include "mfmidi/midi_status.hpp"
+#include "mfmidi/midi_utility.hpp"
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <vector>
+
+namespace mfmidi {
+    /// \brief Program, controller, RPN/NRPN, pressure and bend state of 16 channels
+    ///
+    /// Feed it the messages before a position, then emit() the minimal message set
+    /// which brings a device to the same state. Every value remembers the tick it
+    /// was set at, so states of several tracks can be merged.
+    class chase_state {
+    public:
+        /// \brief Value of a RPN or NRPN set by data entry
+        struct parameter {
+            bool                   nrpn;
+            uint16_t               number; ///< msb << 7 | lsb
+            std::optional<uint8_t> msb;
+            std::optional<uint8_t> lsb;
+            uint64_t               tick;
+        };
+
+        struct channel {
+            channel_voice_control_status status;
+
+            std::array<uint64_t, 120> controller_ticks{};
+            uint64_t                  program_tick{};
+            uint64_t                  aftertouch_tick{};
+            uint64_t                  pitchbend_tick{};
+
+            bool                   select_nrpn = false; ///< data entry goes to NRPN (CC 99/98) instead of RPN (CC 101/100)
+            uint64_t               select_tick{};
+            std::vector<parameter> parameters;
+        };
+
+        [[nodiscard]] const channel& operator[](uint8_t ch) const noexcept
+        {
+            return _channels[ch & 0x0FU];
+        }
+
+        void clear() noexcept
+        {
+            for (auto& ch : _channels) {
+                ch.status = {};
+                ch.controller_ticks.fill(0);
+                ch.program_tick = ch.aftertouch_tick = ch.pitchbend_tick = ch.select_tick = 0;
+                ch.select_nrpn                                                             = false;
+                ch.parameters.clear();
+            }
+        }
+
+        /// \brief Apply one message at \a tick, messages which do not change channel state are ignored
+        void process(std::span<const uint8_t> msg, uint64_t tick = 0)
+        {
+            if (msg.empty()) {
+                return;
+            }
+            const uint8_t status = msg[0];
+            channel&      ch     = _channels[status & 0x0FU];
+            switch (status & 0xF0U) {
+            case MIDIMsgStatus::CONTROL_CHANGE:
+                if (msg.size() >= 3) {
+                    control_change(ch, msg[1] & 0x7FU, msg[2], tick);
+                }
+                break;
+            case MIDIMsgStatus::PROGRAM_CHANGE:
+                if (msg.size() >= 2) {
+                    ch.status.program = msg[1];
+                    ch.program_tick   = tick;
+                }
+                break;
+            case MIDIMsgStatus::CHANNEL_PRESSURE:
+                if (msg.size() >= 2) {
+                    ch.status.aftertouch = msg[1];
+                    ch.aftertouch_tick   = tick;
+                }
+                break;
+            case MIDIMsgStatus::PITCH_BEND:
+                if (msg.size() >= 3) {
+                    ch.status.pitchbend = static_cast<int16_t>(((msg[2] << 7U) | msg[1]) - 8192);
+                    ch.pitchbend_tick   = tick;
+                }
+                break;
+            case MIDIMsgStatus::SYSEX_START:
+                // GM System On resets the receiver
+                if (status == MIDIMsgStatus::SYSEX_START) {
+                    const auto body = sysex_body(msg);
+                    if (body.size() >= 5 && body[0] == 0x7E && body[2] == 0x09 && (body[3] == 0x01 || body[3] == 0x03)) {
+                        clear();
+                    }
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        /// \brief Apply timed messages in [\a first, \a last)
+        /// \param tick Absolute tick before \a first
+        /// \return Absolute tick of the last message
+        template <std::input_iterator It, std::sentinel_for<It> S>
+        uint64_t process(It first, S last, uint64_t tick = 0)
+        {
+            for (; first != last; ++first) {
+                if constexpr (requires {
+                                  { first.running_status() } -> std::convertible_to<uint8_t>;
+                                  { first.delta_time() } -> std::convertible_to<uint64_t>;
+                              }) {
+                    // iterators of SMF tracks know the status, do not build notes
+                    tick += first.delta_time();
+                    if (is_chased_status(first.running_status())) {
+                        auto&& msg = *first;
+                        process(std::span<const uint8_t>{std::ranges::data(msg), std::ranges::size(msg)}, tick);
+                    }
+                } else {
+                    auto&& msg = *first;
+                    tick += msg.delta_time();
+                    process(std::span<const uint8_t>{std::ranges::data(msg), std::ranges::size(msg)}, tick);
+                }
+            }
+            return tick;
+        }
+
+        /// \brief Merge \a other into this, the later value wins, \a other wins ties
+        void merge(const chase_state& other)
+        {
+            for (size_t idx = 0; idx < _channels.size(); ++idx) {
+                channel&       ch   = _channels[idx];
+                const channel& from = other._channels[idx];
+                merge_value(ch.status.program, ch.program_tick, from.status.program, from.program_tick);
+                merge_value(ch.status.aftertouch, ch.aftertouch_tick, from.status.aftertouch, from.aftertouch_tick);
+                merge_value(ch.status.pitchbend, ch.pitchbend_tick, from.status.pitchbend, from.pitchbend_tick);
+                for (size_t cc = 0; cc < ch.status.controllers.size(); ++cc) {
+                    merge_value(ch.status.controllers[cc], ch.controller_ticks[cc], from.status.controllers[cc], from.controller_ticks[cc]);
+                }
+                if (from.select_tick >= ch.select_tick && (from.select_tick != 0 || from.select_nrpn)) {
+                    ch.select_nrpn = from.select_nrpn;
+                    ch.select_tick = from.select_tick;
+                }
+                for (const parameter& param : from.parameters) {
+                    parameter* found = find_parameter(ch, param.nrpn, param.number);
+                    if (found == nullptr) {
+                        ch.parameters.push_back(param);
+                    } else if (param.tick >= found->tick) {
+                        *found = param;
+                    }
+                }
+            }
+        }
+
+        /// \brief Call \c f(std::span<const uint8_t>) with every message needed to restore the state
+        ///
+        /// Per channel: bank select and program, controllers, RPN/NRPN values then the
+        /// selected parameter, pitch bend, channel pressure.
+        template <std::invocable<std::span<const uint8_t>> F>
+        void emit(F&& f) const
+        {
+            for (uint8_t idx = 0; idx < _channels.size(); ++idx) {
+                const channel& ch = _channels[idx];
+                const auto&    cc = ch.status.controllers;
+
+                const auto control = [&](uint8_t number, uint8_t value) {
+                    const uint8_t msg[]{static_cast<uint8_t>(MIDIMsgStatus::CONTROL_CHANGE | idx), number, value};
+                    f(std::span<const uint8_t>{msg});
+                };
+
+                if (cc[MIDICCNumber::BANK]) {
+                    control(MIDICCNumber::BANK, *cc[MIDICCNumber::BANK]);
+                }
+                if (cc[MIDICCNumber::BANK_LSB]) {
+                    control(MIDICCNumber::BANK_LSB, *cc[MIDICCNumber::BANK_LSB]);
+                }
+                if (ch.status.program) {
+                    const uint8_t msg[]{static_cast<uint8_t>(MIDIMsgStatus::PROGRAM_CHANGE | idx), *ch.status.program};
+                    f(std::span<const uint8_t>{msg});
+                }
+                for (uint8_t number = 0; number < cc.size(); ++number) {
+                    if (cc[number] && !is_special_controller(number)) {
+                        control(number, *cc[number]);
+                    }
+                }
+                for (const parameter& param : ch.parameters) {
+                    control(param.nrpn ? MIDICCNumber::NRPN_MSB : MIDICCNumber::RPN_MSB, param.number >> 7U);
+                    control(param.nrpn ? MIDICCNumber::NRPN_LSB : MIDICCNumber::RPN_LSB, param.number & 0x7FU);
+                    if (param.msb) {
+                        control(MIDICCNumber::DATA_ENTRY, *param.msb);
+                    }
+                    if (param.lsb) {
+                        control(MIDICCNumber::DATA_ENTRY_LSB, *param.lsb);
+                    }
+                }
+                const uint8_t select_msb = ch.select_nrpn ? MIDICCNumber::NRPN_MSB : MIDICCNumber::RPN_MSB;
+                const uint8_t select_lsb = ch.select_nrpn ? MIDICCNumber::NRPN_LSB : MIDICCNumber::RPN_LSB;
+                if (cc[select_msb] || cc[select_lsb]) {
+                    control(select_msb, cc[select_msb].value_or(0x7F));
+                    control(select_lsb, cc[select_lsb].value_or(0x7F));
+                } else if (!ch.parameters.empty()) { // deselect
+                    control(MIDICCNumber::RPN_MSB, 0x7F);
+                    control(MIDICCNumber::RPN_LSB, 0x7F);
+                }
+                if (ch.status.pitchbend) {
+                    const auto    value = static_cast<uint16_t>(*ch.status.pitchbend + 8192);
+                    const uint8_t msg[]{static_cast<uint8_t>(MIDIMsgStatus::PITCH_BEND | idx), static_cast<uint8_t>(value & 0x7FU), static_cast<uint8_t>(value >> 7U)};
+                    f(std::span<const uint8_t>{msg});
+                }
+                if (ch.status.aftertouch) {
+                    const uint8_t msg[]{static_cast<uint8_t>(MIDIMsgStatus::CHANNEL_PRESSURE | idx), *ch.status.aftertouch};
+                    f(std::span<const uint8_t>{msg});
+                }
+            }
+        }
+
+        /// \brief Send the state to \a dev with a single send_batch
+        /// \return Count of messages, 0 if the device failed
+        size_t send(midi_device& dev) const
+        {
+            std::vector<uint8_t> bytes;
+            std::vector<size_t>  ends;
+            emit([&](std::span<const uint8_t> msg) {
+                bytes.insert(bytes.end(), msg.begin(), msg.end());
+                ends.push_back(bytes.size());
+            });
+
+            std::vector<message_ref> msgs;
+            msgs.reserve(ends.size());
+            size_t begin = 0;
+            for (size_t end : ends) {
+                msgs.emplace_back(bytes.data() + begin, end - begin);
+                begin = end;
+            }
+            return dev.send_batch(msgs) ? msgs.size() : 0;
+        }
+
+    private:
+        std::array<channel, 16> _channels{};
+
+        static constexpr bool is_chased_status(uint8_t status) noexcept
+        {
+            return status >= MIDIMsgStatus::CONTROL_CHANGE && status <= MIDIMsgStatus::SYSEX_START; // control, program, pressure, bend and sysex
+        }
+
+        /// \brief Bytes after F0 of a sysex in wire format, or after the length of a SMF sysex
+        static constexpr std::span<const uint8_t> sysex_body(std::span<const uint8_t> msg) noexcept
+        {
+            const auto body   = msg.subspan(1);
+            uint32_t   length = 0;
+            for (size_t index = 0; index < std::min<size_t>(body.size(), 4); ++index) {
+                length = (length << 7U) | (body[index] & 0x7FU);
+                if ((body[index] & 0x80U) == 0) {
+                    return length == body.size() - index - 1 ? body.subspan(index + 1) : body;
+                }
+            }
+            return body;
+        }
+
+        static constexpr bool is_special_controller(uint8_t number) noexcept
+        {
+            switch (number) {
+            case MIDICCNumber::BANK:
+            case MIDICCNumber::BANK_LSB:
+            case MIDICCNumber::DATA_ENTRY:
+            case MIDICCNumber::DATA_ENTRY_LSB:
+            case MIDICCNumber::DATA_INC:
+            case MIDICCNumber::DATA_DEC:
+            case MIDICCNumber::NRPN_LSB:
+            case MIDICCNumber::NRPN_MSB:
+            case MIDICCNumber::RPN_LSB:
+            case MIDICCNumber::RPN_MSB:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        template <class T>
+        static void merge_value(std::optional<T>& value, uint64_t& tick, const std::optional<T>& other, uint64_t other_tick)
+        {
+            if (other && (!value || other_tick >= tick)) {
+                value = other;
+                tick  = other_tick;
+            }
+        }
+
+        static parameter* find_parameter(channel& ch, bool nrpn, uint16_t number) noexcept
+        {
+            auto found = std::ranges::find_if(ch.parameters, [&](const parameter& param) { return param.nrpn == nrpn && param.number == number; });
+            return found == ch.parameters.end() ? nullptr : &*found;
+        }
+
+        /// \brief Parameter selected for data entry, nullptr if none or null
+        static parameter* selected_parameter(channel& ch, uint64_t tick)
+        {
+            const auto& cc  = ch.status.controllers;
+            const auto  msb = cc[ch.select_nrpn ? MIDICCNumber::NRPN_MSB : MIDICCNumber::RPN_MSB];
+            const auto  lsb = cc[ch.select_nrpn ? MIDICCNumber::NRPN_LSB : MIDICCNumber::RPN_LSB];
+            if (!msb || !lsb || (*msb == 0x7F && *lsb == 0x7F)) {
+                return nullptr;
+            }
+            const auto number = static_cast<uint16_t>((*msb << 7U) | *lsb);
+            if (parameter* found = find_parameter(ch, ch.select_nrpn, number)) {
+                return found;
+            }
+            return &ch.parameters.emplace_back(parameter{ch.select_nrpn, number, std::nullopt, std::nullopt, tick});
+        }
+
+        static void control_change(channel& ch, uint8_t number, uint8_t value, uint64_t tick)
+        {
+            auto& cc = ch.status.controllers;
+            switch (number) {
+            case MIDICCNumber::DATA_ENTRY:
+            case MIDICCNumber::DATA_ENTRY_LSB:
+            case MIDICCNumber::DATA_INC:
+            case MIDICCNumber::DATA_DEC:
+                if (parameter* param = selected_parameter(ch, tick)) {
+                    if (number == MIDICCNumber::DATA_ENTRY) {
+                        param->msb = value;
+                    } else if (number == MIDICCNumber::DATA_ENTRY_LSB) {
+                        param->lsb = value;
+                    } else {
+                        const int step = number == MIDICCNumber::DATA_INC ? 1 : -1;
+                        param->msb     = static_cast<uint8_t>(std::clamp(param->msb.value_or(0) + step, 0, 0x7F));
+                    }
+                    param->tick = tick;
+                }
+                return;
+            case MIDICCNumber::NRPN_LSB:
+            case MIDICCNumber::NRPN_MSB:
+            case MIDICCNumber::RPN_LSB:
+            case MIDICCNumber::RPN_MSB:
+                ch.select_nrpn = number == MIDICCNumber::NRPN_LSB || number == MIDICCNumber::NRPN_MSB;
+                ch.select_tick = tick;
+                break;
+            case MIDICCNumber::RESET_CC: // RP-015 Reset All Controllers
+                for (uint8_t reset : {MIDICCNumber::MODULATION, MIDICCNumber::SUSTAIN, MIDICCNumber::PORTA, MIDICCNumber::SOSTENUTO, MIDICCNumber::SOFT}) {
+                    cc[reset]                  = 0;
+                    ch.controller_ticks[reset] = tick;
+                }
+                cc[MIDICCNumber::EXPRESSION]                  = 0x7F;
+                ch.controller_ticks[MIDICCNumber::EXPRESSION] = tick;
+                for (uint8_t reset : {MIDICCNumber::RPN_MSB, MIDICCNumber::RPN_LSB}) {
+                    cc[reset]                  = 0x7F;
+                    ch.controller_ticks[reset] = tick;
+                }
+                ch.select_nrpn       = false;
+                ch.select_tick       = tick;
+                ch.status.pitchbend  = 0;
+                ch.pitchbend_tick    = tick;
+                ch.status.aftertouch = 0;
+                ch.aftertouch_tick   = tick;
+                return;
+            default:
+                break;
+            }
+            if (number < cc.size()) { // channel mode messages do not change controllers
+                cc[number]                  = value;
+                ch.controller_ticks[number] = tick;
+            }
+        }
+    };
+}
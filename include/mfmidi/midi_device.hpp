@@ -20,9 +20,13 @@
 #include "mfmidi/midi_message.hpp"
 #include <expected>
 #include <functional>
+#include <span>
 #include <utility>
 
 namespace mfmidi {
+    /// \brief Bytes of a message to send, they only have to live during the call
+    using message_ref = std::span<const uint8_t>;
+
     class midi_device {
     public:
         midi_device() noexcept = default;
@@ -43,6 +47,23 @@ namespace mfmidi {
         virtual bool close() = 0;
 
         virtual std::expected<void, const char*> send_msg(std::span<const uint8_t> msg) noexcept = 0;
+
+        /// \brief Send messages in order, such as the events of a single time point
+        ///
+        /// Messages after a failed one are still sent.
+        ///
+        /// \return The first error
+        virtual std::expected<void, const char*> send_batch(std::span<const message_ref> msgs) noexcept
+        {
+            std::expected<void, const char*> result;
+            for (message_ref msg : msgs) {
+                auto sent = send_msg(msg);
+                if (!sent && result) {
+                    result = sent;
+                }
+            }
+            return result;
+        }
     };
 
     inline void sendAllSoundsOff(midi_device* dev) // todo: get this out
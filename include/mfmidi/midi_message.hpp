@@ -249,6 +249,12 @@ namespace mfmidi {
             return tempo::from_mspq(rawcat(_data[3], _data[4], _data[5]));
         }
 
+        [[nodiscard]] constexpr uint8_t output_port() const
+        {
+            C(is_output_port());
+            return _data[3];
+        }
+
         [[nodiscard]] constexpr std::string_view text() const
         {
             C(is_text_event());
@@ -631,6 +637,11 @@ namespace mfmidi {
             return is_meta_event_like() && L(2) && (_data[1] == MIDIMetaNumber::TEMPO);
         }
 
+        [[nodiscard]] constexpr bool is_output_port() const
+        {
+            return is_meta_event_like() && L(4) && (_data[1] == MIDIMetaNumber::OUTPUT_PORT);
+        }
+
         [[nodiscard]] constexpr bool is_end_of_track() const
         {
             return is_meta_event_like() && L(2) && (_data[1] == MIDIMetaNumber::END_OF_TRACK);
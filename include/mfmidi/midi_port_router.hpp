@@ -0,0 +1,129 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/// \file midi_port_router.hpp
+/// \brief Route SMF output ports to devices
+
+#pragma once
+
+#include "mfmidi/device/buffered_output_device.hpp"
+#include "mfmidi/midi_device.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace mfmidi {
+    /// \brief Port of a track which has not reached an Output Port meta event
+    inline constexpr uint16_t no_output_port = 0x100;
+
+    /// \brief Devices of SMF output ports (meta event 0x21), optionally per channel
+    ///
+    /// A playhead sends to its own device until its track selects a port, and when
+    /// neither the channel nor the port has a route. Per track routing is the device
+    /// of the playhead. A buffered route goes through a buffered_output_device owned
+    /// by the router, one per target device, so a slow device does not delay the others.
+    ///
+    /// The queues of buffered routes take a single producer, so a router with
+    /// buffered routes must have exactly one producing thread at a time. One group
+    /// is fine, it sends from its player thread or from a caller while that thread
+    /// is parked. Give each group its own router, or route without buffering.
+    ///
+    /// Routes must not change while a playing group uses the router.
+    class port_router {
+    public:
+        /// \brief Send messages of \a port to \a device, nullptr to remove the route
+        /// \param buffered Queue them on the router's own queue of \a device
+        void set_port(uint8_t port, midi_device* device, bool buffered = true)
+        {
+            entry_of(port).device = target_of(device, buffered);
+        }
+
+        /// \brief Send channel messages of \a channel on \a port to \a device, overriding the port route
+        void set_channel(uint8_t port, uint8_t channel, midi_device* device, bool buffered = true)
+        {
+            entry_of(port).channels[channel & 0x0FU] = target_of(device, buffered);
+        }
+
+        /// \brief Device of \a msg sent on \a port, \a fallback if not routed
+        [[nodiscard]] midi_device* device(uint16_t port, std::span<const uint8_t> msg, midi_device* fallback) const noexcept
+        {
+            if (port >= _ports.size()) {
+                return fallback;
+            }
+            const port_entry& entry = _ports[port];
+            if (!msg.empty() && msg[0] >= 0x80 && msg[0] < 0xF0 && entry.channels[msg[0] & 0x0FU] != nullptr) {
+                return entry.channels[msg[0] & 0x0FU];
+            }
+            return entry.device != nullptr ? entry.device : fallback;
+        }
+
+        /// \brief Route of \a port for messages other than channel messages
+        [[nodiscard]] midi_device* port_device(uint8_t port) const noexcept
+        {
+            return port < _ports.size() ? _ports[port].device : nullptr;
+        }
+
+        /// \brief Block until every buffered message is handed to its device
+        void flush() const noexcept
+        {
+            for (const auto& buffer : _buffers) {
+                buffer->flush();
+            }
+        }
+
+        /// \brief Remove every route and queue, queued messages are sent first
+        void clear()
+        {
+            flush();
+            _ports.clear();
+            _buffers.clear();
+        }
+
+    private:
+        struct port_entry {
+            midi_device*                 device{};
+            std::array<midi_device*, 16> channels{};
+        };
+
+        std::vector<port_entry>                              _ports; // indexed by port
+        std::vector<std::unique_ptr<buffered_output_device>> _buffers;
+
+        port_entry& entry_of(uint8_t port)
+        {
+            if (port >= _ports.size()) {
+                _ports.resize(port + 1);
+            }
+            return _ports[port];
+        }
+
+        midi_device* target_of(midi_device* device, bool buffered)
+        {
+            if (device == nullptr || !buffered) {
+                return device;
+            }
+            auto found = std::ranges::find(_buffers, device, [](const auto& buffer) { return &buffer->target(); });
+            if (found != _buffers.end()) {
+                return found->get();
+            }
+            return _buffers.emplace_back(std::make_unique<buffered_output_device>(*device)).get();
+        }
+    };
+}
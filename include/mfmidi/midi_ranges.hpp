@@ -1,11 +1,19 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cassert>
 #include <concepts>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
 #include <optional>
 #include <ranges>
 #include <span>
+#include <string>
 #include <string_view>
 #include <tuple>
+#include <variant>
 
 namespace mfmidi {
     namespace details {
@@ -60,9 +68,111 @@ namespace mfmidi {
         };
     }
 
+    /// \brief Contiguous storage with fixed capacity, never allocates
+    template <class T, size_t N>
+        requires(N <= std::numeric_limits<uint8_t>::max())
+    class inline_vector {
+        std::array<T, N> _data{};
+        uint8_t          _size{};
+
+    public:
+        using value_type      = T;
+        using size_type       = size_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer         = T*;
+        using const_pointer   = const T*;
+        using reference       = T&;
+        using const_reference = const T&;
+        using iterator        = pointer;
+        using const_iterator  = const_pointer;
+
+        constexpr inline_vector() noexcept = default;
+
+        constexpr inline_vector(std::initializer_list<T> init) noexcept
+        {
+            append(init.begin(), init.size());
+        }
+
+        [[nodiscard]] static constexpr size_type capacity() noexcept
+        {
+            return N;
+        }
+
+        constexpr void push_back(const T& val) noexcept
+        {
+            assert(_size < N);
+            _data[_size++] = val;
+        }
+
+        constexpr void append(const T* first, size_type count) noexcept
+        {
+            assert(_size + count <= N);
+            std::copy_n(first, count, _data.begin() + _size);
+            _size += static_cast<uint8_t>(count);
+        }
+
+        constexpr void clear() noexcept
+        {
+            _size = 0;
+        }
+
+        [[nodiscard]] constexpr pointer data() noexcept
+        {
+            return _data.data();
+        }
+
+        [[nodiscard]] constexpr const_pointer data() const noexcept
+        {
+            return _data.data();
+        }
+
+        [[nodiscard]] constexpr iterator begin() noexcept
+        {
+            return data();
+        }
+
+        [[nodiscard]] constexpr const_iterator begin() const noexcept
+        {
+            return data();
+        }
+
+        [[nodiscard]] constexpr iterator end() noexcept
+        {
+            return data() + _size;
+        }
+
+        [[nodiscard]] constexpr const_iterator end() const noexcept
+        {
+            return data() + _size;
+        }
+
+        [[nodiscard]] constexpr size_type size() const noexcept
+        {
+            return _size;
+        }
+
+        [[nodiscard]] constexpr bool empty() const noexcept
+        {
+            return _size == 0;
+        }
+
+        [[nodiscard]] constexpr reference operator[](size_type idx) noexcept
+        {
+            return _data[idx];
+        }
+
+        [[nodiscard]] constexpr const_reference operator[](size_type idx) const noexcept
+        {
+            return _data[idx];
+        }
+    };
+
+    /// Messages up to this size are stored inline in foreign_vector instead of allocated
+    inline constexpr size_t foreign_vector_inline_capacity = 15;
+
     template <class E>
     class foreign_vector {
-        std::variant<std::span<E>, std::basic_string<std::remove_cv_t<E>>> _base;
+        std::variant<std::span<E>, std::basic_string<std::remove_cv_t<E>>, inline_vector<std::remove_cv_t<E>, foreign_vector_inline_capacity>> _base;
 
     public:
         using value_type      = typename std::span<E>::value_type;
@@ -78,8 +188,9 @@ namespace mfmidi {
         using reverse_iterator       = std::reverse_iterator<iterator>;
         using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
-        using span_type = std::variant_alternative_t<0, decltype(_base)>;
-        using own_type  = std::variant_alternative_t<1, decltype(_base)>;
+        using span_type   = std::variant_alternative_t<0, decltype(_base)>;
+        using own_type    = std::variant_alternative_t<1, decltype(_base)>;
+        using inline_type = std::variant_alternative_t<2, decltype(_base)>;
 
         foreign_vector() = default;
 
@@ -103,6 +214,10 @@ namespace mfmidi {
             : _base(std::move(span))
         {}
 
+        explicit foreign_vector(inline_type small) noexcept
+            : _base(small)
+        {}
+
         foreign_vector& operator=(own_type own)
         {
             _base = own;
@@ -115,11 +230,23 @@ namespace mfmidi {
             return *this;
         }
 
+        foreign_vector& operator=(inline_type small) noexcept
+        {
+            _base = small;
+            return *this;
+        }
+
         [[nodiscard]] bool foreign() const noexcept
         {
             return _base.index() == 0;
         }
 
+        /// \brief If the content is stored inline
+        [[nodiscard]] bool inlined() const noexcept
+        {
+            return _base.index() == 2;
+        }
+
         [[nodiscard]] auto&& own(this auto&& self)
         {
             return std::get<1>(std::forward<decltype(self)>(self)._base);
@@ -132,50 +259,46 @@ namespace mfmidi {
 
         [[nodiscard]] iterator begin()
         {
-            if (foreign()) {
+            switch (_base.index()) {
+            case 0:
                 return std::get<0>(_base).data();
+            case 1:
+                return std::get<1>(_base).data();
+            default:
+                return std::get<2>(_base).data();
             }
-            return std::get<1>(_base).data();
         }
 
         [[nodiscard]] const_iterator begin() const
         {
-            if (foreign()) {
+            switch (_base.index()) {
+            case 0:
                 return std::get<0>(_base).data();
+            case 1:
+                return std::get<1>(_base).data();
+            default:
+                return std::get<2>(_base).data();
             }
-            return std::get<1>(_base).data();
         }
 
         [[nodiscard]] iterator end()
         {
-            if (foreign()) {
-                return std::to_address(std::get<0>(_base).end());
-            }
-            return std::to_address(std::get<1>(_base).end());
+            return begin() + size();
         }
 
         [[nodiscard]] const_iterator end() const
         {
-            if (foreign()) {
-                return std::to_address(std::get<0>(_base).end());
-            }
-            return std::to_address(std::get<1>(_base).end());
+            return begin() + size();
         }
 
         [[nodiscard]] const_iterator cbegin() const noexcept
         {
-            if (foreign()) {
-                return std::to_address(std::get<0>(_base).cbegin());
-            }
-            return std::to_address(std::get<1>(_base).cbegin());
+            return begin();
         }
 
         [[nodiscard]] const_iterator cend() const noexcept
         {
-            if (foreign()) {
-                return std::to_address(std::get<0>(_base).cend());
-            }
-            return std::to_address(std::get<1>(_base).cend());
+            return end();
         }
 
         [[nodiscard]] reverse_iterator rbegin()
@@ -200,42 +323,34 @@ namespace mfmidi {
 
         [[nodiscard]] reference front()
         {
-            if (foreign()) {
-                return std::get<0>(_base).front();
-            }
-            return std::get<1>(_base).front();
+            return *begin();
         }
 
         [[nodiscard]] const_reference front() const
         {
-            if (foreign()) {
-                return std::get<0>(_base).front();
-            }
-            return std::get<1>(_base).front();
+            return *begin();
         }
 
         [[nodiscard]] reference back()
         {
-            if (foreign()) {
-                return std::get<0>(_base).back();
-            }
-            return std::get<1>(_base).back();
+            return *(end() - 1);
         }
 
         [[nodiscard]] const_reference back() const
         {
-            if (foreign()) {
-                return std::get<0>(_base).back();
-            }
-            return std::get<1>(_base).back();
+            return *(end() - 1);
         }
 
         [[nodiscard]] size_type size() const noexcept
         {
-            if (foreign()) {
+            switch (_base.index()) {
+            case 0:
                 return std::get<0>(_base).size();
+            case 1:
+                return std::get<1>(_base).size();
+            default:
+                return std::get<2>(_base).size();
             }
-            return std::get<1>(_base).size();
         }
 
         [[nodiscard]] bool empty() const noexcept
@@ -255,10 +370,7 @@ namespace mfmidi {
 
         [[nodiscard]] auto&& operator[](this auto&& self, size_type idx)
         {
-            if (self.foreign()) {
-                return std::get<0>(std::forward<decltype(self)>(self)._base)[idx];
-            }
-            return std::get<1>(std::forward<decltype(self)>(self)._base)[idx];
+            return std::forward<decltype(self)>(self).begin()[idx];
         }
 
         // ---
@@ -0,0 +1,97 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/// \file mpsc_queue.hpp
+/// \brief Lock-free multiple producer single consumer queue
+
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace mfmidi {
+    /// \brief Unbounded multiple producer single consumer FIFO
+    ///
+    /// push() never blocks and is wait-free, pop() never blocks. Nodes are allocated
+    /// by producers and freed by the consumer. A push is visible to the consumer once
+    /// it linked its node, pushes which are still linking look like an empty queue.
+    template <class T>
+    class mpsc_queue {
+        struct node {
+            std::atomic<node*> next{nullptr};
+            std::optional<T>   value;
+        };
+
+        alignas(64) std::atomic<node*> _head; // last pushed, producers
+        alignas(64) node* _tail;              // already consumed, consumer
+
+    public:
+        mpsc_queue()
+            : _head(new node)
+            , _tail(_head.load(std::memory_order_relaxed))
+        {
+        }
+
+        ~mpsc_queue()
+        {
+            while (pop()) {
+            }
+            delete _tail;
+        }
+
+        mpsc_queue(const mpsc_queue&)            = delete;
+        mpsc_queue(mpsc_queue&&)                 = delete;
+        mpsc_queue& operator=(const mpsc_queue&) = delete;
+        mpsc_queue& operator=(mpsc_queue&&)      = delete;
+
+        /// \brief Thread safe
+        template <class... Args>
+        void emplace(Args&&... args)
+        {
+            auto* added = new node;
+            added->value.emplace(std::forward<Args>(args)...);
+            node* prev = _head.exchange(added, std::memory_order_acq_rel);
+            prev->next.store(added, std::memory_order_release);
+        }
+
+        void push(T value)
+        {
+            emplace(std::move(value));
+        }
+
+        /// \brief Consumer only
+        std::optional<T> pop()
+        {
+            node* next = _tail->next.load(std::memory_order_acquire);
+            if (next == nullptr) {
+                return std::nullopt;
+            }
+            std::optional<T> result{std::move(next->value)};
+            next->value.reset();
+            delete _tail;
+            _tail = next;
+            return result;
+        }
+
+        /// \brief Consumer only
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return _tail->next.load(std::memory_order_acquire) == nullptr;
+        }
+    };
+}
@@ -0,0 +1,194 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/// \file playback_clock.hpp
+/// \brief Clock sources of players
+
+#pragma once
+
+#include "mfmidi/timingapi.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+namespace mfmidi {
+    namespace details {
+        /// \brief Hint the CPU that we are busy waiting
+        inline void cpu_relax() noexcept
+        {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+            _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+            __asm__ __volatile__("yield");
+#endif
+        }
+    }
+
+    /// \brief Time source and waiter of a player
+    ///
+    /// Players compute absolute deadlines from a start instant of the clock, so
+    /// late wakeups are caught up and never accumulate.
+    class playback_clock {
+    public:
+        using Time = std::chrono::nanoseconds;
+
+        playback_clock() noexcept = default;
+
+        playback_clock(playback_clock&&) noexcept                 = default;
+        playback_clock& operator=(playback_clock&&) noexcept      = default;
+        playback_clock(const playback_clock&) noexcept            = default;
+        playback_clock& operator=(const playback_clock&) noexcept = default;
+
+        virtual ~playback_clock() noexcept = default;
+
+        [[nodiscard]] virtual Time now() noexcept = 0;
+
+        /// \brief Block until now() reaches \a deadline, return at once if passed
+        virtual void sleep_until(Time deadline) noexcept = 0;
+    };
+
+    /// \brief Wall time, CLOCK_MONOTONIC on POSIX
+    class monotonic_clock final : public playback_clock {
+    public:
+        [[nodiscard]] Time now() noexcept override
+        {
+            return hiresticktime();
+        }
+
+        void sleep_until(Time deadline) noexcept override
+        {
+            mfmidi::sleep_until(deadline);
+        }
+
+        /// \brief Shared instance, the default clock of players
+        [[nodiscard]] static monotonic_clock& instance() noexcept
+        {
+            static monotonic_clock clock;
+            return clock;
+        }
+    };
+
+    /// \brief Wall time, sleeps until a spin window before the deadline then busy waits
+    ///
+    /// Wakeups of a plain sleep land tens of microseconds late under load, the spin
+    /// absorbs that at the cost of one busy core during the window.
+    class hybrid_clock final : public playback_clock {
+        std::atomic<Time::rep> _spin_window;
+
+    public:
+        explicit hybrid_clock(Time spin_window = std::chrono::microseconds{200}) noexcept
+            : _spin_window(spin_window.count())
+        {
+        }
+
+        [[nodiscard]] Time now() noexcept override
+        {
+            return hiresticktime();
+        }
+
+        void sleep_until(Time deadline) noexcept override
+        {
+            const Time coarse = deadline - spin_window();
+            if (hiresticktime() < coarse) {
+                mfmidi::sleep_until(coarse);
+            }
+            while (hiresticktime() < deadline) {
+                details::cpu_relax();
+            }
+        }
+
+        [[nodiscard]] Time spin_window() const noexcept
+        {
+            return Time{_spin_window.load(std::memory_order_relaxed)};
+        }
+
+        /// \brief Can be changed while a player is waiting on the clock
+        void set_spin_window(Time window) noexcept
+        {
+            _spin_window.store(std::max(window, Time{}).count(), std::memory_order_relaxed);
+        }
+
+        /// \brief Measure how late sleeps of \a probe wake up and use it as spin window
+        ///
+        /// Blocks for about \a samples * \a probe. Run it on the thread (and with the
+        /// priority) that will play.
+        ///
+        /// \param quantile Lateness quantile to cover, 1 for the worst seen
+        /// \return The new spin window
+        Time calibrate(size_t samples = 64, Time probe = std::chrono::milliseconds{1}, double quantile = 0.99)
+        {
+            std::vector<Time> lateness;
+            lateness.reserve(samples);
+            for (size_t i = 0; i < samples; ++i) {
+                const Time deadline = hiresticktime() + probe;
+                mfmidi::sleep_until(deadline);
+                lateness.push_back(hiresticktime() - deadline);
+            }
+            if (lateness.empty()) {
+                return spin_window();
+            }
+            std::ranges::sort(lateness);
+            const auto index = static_cast<size_t>(std::clamp(quantile, 0.0, 1.0) * static_cast<double>(lateness.size() - 1));
+            set_spin_window(lateness[index] * 2); // some margin for unlucky wakeups
+            return spin_window();
+        }
+    };
+
+    /// \brief Manually driven time, sleeping jumps to the deadline at once
+    ///
+    /// A player on this clock runs as fast as it can while seeing the same
+    /// timeline as on a wall clock, useful for tests and offline rendering.
+    class virtual_clock final : public playback_clock {
+        std::atomic<Time::rep> _now{};
+
+    public:
+        virtual_clock() noexcept = default;
+
+        explicit virtual_clock(Time start) noexcept
+            : _now(start.count())
+        {
+        }
+
+        [[nodiscard]] Time now() noexcept override
+        {
+            return Time{_now.load(std::memory_order_acquire)};
+        }
+
+        void sleep_until(Time deadline) noexcept override
+        {
+            Time::rep current = _now.load(std::memory_order_relaxed);
+            while (current < deadline.count() && !_now.compare_exchange_weak(current, deadline.count(), std::memory_order_acq_rel)) {
+            }
+        }
+
+        void advance(Time duration) noexcept
+        {
+            _now.fetch_add(duration.count(), std::memory_order_acq_rel);
+        }
+
+        void set(Time time) noexcept
+        {
+            _now.store(time.count(), std::memory_order_release);
+        }
+    };
+}
@@ -0,0 +1,204 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/// \file player_metrics.hpp
+/// \brief Lock-free counters of a player
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+
+namespace mfmidi {
+    /// \brief Histogram of durations in logarithmic buckets
+    ///
+    /// Every power of two is split into 4 buckets, so a bucket is at most 25% wide.
+    /// Recording is one relaxed increment, reading is safe from any thread.
+    class duration_histogram {
+    public:
+        using Time = std::chrono::nanoseconds;
+
+        static constexpr size_t sub_buckets  = 4;
+        static constexpr size_t max_exponent = 40; // about 18 minutes, longer ones go to the last bucket
+        static constexpr size_t bucket_count = (max_exponent - 1) * sub_buckets + 1;
+
+        void record(Time duration) noexcept
+        {
+            _buckets[bucket_of(duration)].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] uint64_t count(size_t bucket) const noexcept
+        {
+            return _buckets[bucket].load(std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] uint64_t total() const noexcept
+        {
+            uint64_t result = 0;
+            for (const auto& bucket : _buckets) {
+                result += bucket.load(std::memory_order_relaxed);
+            }
+            return result;
+        }
+
+        /// \brief Smallest duration of \a bucket
+        [[nodiscard]] static constexpr Time lower_bound(size_t bucket) noexcept
+        {
+            if (bucket < sub_buckets) {
+                return Time{static_cast<Time::rep>(bucket)};
+            }
+            const size_t exponent = bucket / sub_buckets + 1;
+            const size_t sub      = bucket % sub_buckets;
+            return Time{static_cast<Time::rep>((uint64_t{sub_buckets} + sub) << (exponent - 2))};
+        }
+
+        [[nodiscard]] static constexpr size_t bucket_of(Time duration) noexcept
+        {
+            const auto value = static_cast<uint64_t>(std::max(duration.count(), Time::rep{0}));
+            if (value < sub_buckets) {
+                return value;
+            }
+            const auto exponent = static_cast<size_t>(std::bit_width(value) - 1);
+            if (exponent >= max_exponent) {
+                return bucket_count - 1;
+            }
+            const size_t sub = (value >> (exponent - 2)) & (sub_buckets - 1);
+            return (exponent - 1) * sub_buckets + sub;
+        }
+
+        /// \brief Upper bound of the bucket holding the \a quantile (0 to 1) of recorded durations
+        [[nodiscard]] Time quantile(double quantile) const noexcept
+        {
+            const uint64_t all = total();
+            if (all == 0) {
+                return {};
+            }
+            const auto target = static_cast<uint64_t>(std::clamp(quantile, 0.0, 1.0) * static_cast<double>(all - 1)) + 1;
+            uint64_t   seen   = 0;
+            for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+                seen += count(bucket);
+                if (seen >= target) {
+                    return bucket + 1 < bucket_count ? lower_bound(bucket + 1) : Time::max();
+                }
+            }
+            return Time::max();
+        }
+
+        void reset() noexcept
+        {
+            for (auto& bucket : _buckets) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        std::array<std::atomic<uint64_t>, bucket_count> _buckets{};
+    };
+
+    /// \brief Instrumentation of a player thread
+    ///
+    /// Written by the player thread only, every member can be read from any thread
+    /// without locking. Values of different members may come from different wakeups.
+    class player_metrics {
+    public:
+        using Time = std::chrono::nanoseconds;
+
+        std::atomic<uint64_t>  events{0};            ///< messages given to devices
+        std::atomic<uint64_t>  wakeups{0};           ///< wakeups while playing
+        std::atomic<double>    events_per_second{0}; ///< over the last second of playing
+        std::atomic<Time::rep> max_lateness{0};      ///< latest wakeup after its deadline, in ns
+
+        duration_histogram oversleep;  ///< how late wakeups are
+        duration_histogram undersleep; ///< how early wakeups are, clocks should not do that
+
+        std::atomic<size_t> playheads{0};      ///< playheads left to play
+        std::atomic<size_t> timed_commands{0}; ///< commands waiting for their time
+        std::atomic<size_t> max_batch{0};      ///< most messages sent by one wakeup
+
+        duration_histogram     send_time;         ///< time of sending the messages of a wakeup
+        std::atomic<Time::rep> send_time_total{0}; ///< in ns
+
+        /// \brief Lateness of a wakeup, negative if early
+        void record_wakeup(Time late) noexcept
+        {
+            wakeups.fetch_add(1, std::memory_order_relaxed);
+            if (late < Time{}) {
+                undersleep.record(-late);
+                return;
+            }
+            oversleep.record(late);
+            if (late.count() > max_lateness.load(std::memory_order_relaxed)) {
+                max_lateness.store(late.count(), std::memory_order_relaxed);
+            }
+        }
+
+        /// \brief \a count messages were sent in \a duration
+        void record_send(size_t count, Time duration) noexcept
+        {
+            events.fetch_add(count, std::memory_order_relaxed);
+            send_time.record(duration);
+            send_time_total.fetch_add(duration.count(), std::memory_order_relaxed);
+            if (count > max_batch.load(std::memory_order_relaxed)) {
+                max_batch.store(count, std::memory_order_relaxed);
+            }
+        }
+
+        /// \brief Update events_per_second once a second
+        void update_rate(Time now) noexcept
+        {
+            const Time elapsed = now - _window_begin;
+            if (elapsed < std::chrono::seconds{1}) {
+                return;
+            }
+            const uint64_t current = events.load(std::memory_order_relaxed);
+            if (current >= _window_events) { // not reset meanwhile
+                events_per_second.store(static_cast<double>(current - _window_events) / std::chrono::duration<double>(elapsed).count(), std::memory_order_relaxed);
+            }
+            _window_begin  = now;
+            _window_events = current;
+        }
+
+        /// \brief Start a new rate window, when playback starts
+        void restart_rate(Time now) noexcept
+        {
+            _window_begin  = now;
+            _window_events = events.load(std::memory_order_relaxed);
+        }
+
+        void reset() noexcept
+        {
+            events.store(0, std::memory_order_relaxed);
+            wakeups.store(0, std::memory_order_relaxed);
+            events_per_second.store(0, std::memory_order_relaxed);
+            max_lateness.store(0, std::memory_order_relaxed);
+            oversleep.reset();
+            undersleep.reset();
+            max_batch.store(0, std::memory_order_relaxed);
+            send_time.reset();
+            send_time_total.store(0, std::memory_order_relaxed);
+        }
+
+    private:
+        // player thread only
+        Time     _window_begin{};
+        uint64_t _window_events{};
+    };
+}
@@ -18,7 +18,11 @@
 #pragma once
 
 #include "mfmidi/smf/division.hpp"
+#include "mfmidi/smf/load_smf.hpp"
+#include "mfmidi/smf/packed_track.hpp"
 #include "mfmidi/smf/smf.hpp"
 #include "mfmidi/smf/smf_error.hpp"
 #include "mfmidi/smf/span_track.hpp"
+#include "mfmidi/smf/span_track_index.hpp"
+#include "mfmidi/smf/tempo_map.hpp"
 #include "mfmidi/smf/variable_number.hpp"
@@ -32,7 +32,7 @@ namespace mfmidi {
 
         /// \param fps Positive FPS like 25, 29(means 29.97)...
         constexpr division(uint8_t fps, uint8_t tpf) noexcept
-            : _val((-fps << 8) & tpf)
+            : _val(static_cast<uint16_t>((-fps << 8) | tpf))
         {
         }
 
@@ -108,21 +108,132 @@ namespace mfmidi {
         }
     }
 
-    constexpr std::chrono::nanoseconds division_to_duration(division val, tempo bpm) noexcept
+    namespace details {
+        /// \brief Duration of a tick as the exact fraction \c num / \c den nanoseconds
+        struct tick_ratio {
+            uint64_t num;
+            uint64_t den;
+        };
+
+        constexpr tick_ratio division_tick_ratio(division val, tempo bpm) noexcept
+        {
+            if (!val) {
+                return {0, 1};
+            }
+            if (val.is_ppq()) {
+                // mspq us per quarter
+                return {uint64_t{bpm.mspq()} * 1'000, val.ppq()};
+            }
+            // 24 25 29(30000/1001) 30 frames per second
+            if (val.fps() == 29) {
+                return {uint64_t{1'000'000'000} * 1001, uint64_t{30000} * val.tpf()};
+            }
+            return {1'000'000'000, uint64_t{val.fps()} * val.tpf()};
+        }
+
+        /// \brief \c value * \c num / \c den rounded down
+        ///
+        /// The product is split by \c den, so it is exact whenever the result and
+        /// (\c den - 1) * \c num fit in 64 bits.
+        constexpr uint64_t mul_div(uint64_t value, uint64_t num, uint64_t den) noexcept
+        {
+            return (value / den * num) + (value % den * num / den);
+        }
+    }
+
+    /// \brief Exact duration of \a ticks, rounded down to nanoseconds
+    ///
+    /// Sum of rounded tick durations drifts, so always convert a whole tick count
+    /// from a known point instead.
+    constexpr std::chrono::nanoseconds ticks_to_duration(division val, tempo bpm, uint64_t ticks) noexcept
     {
         using result_type = std::chrono::nanoseconds;
-        if (!val || !bpm) {
+        const auto ratio  = details::division_tick_ratio(val, bpm);
+        if (ratio.num == 0) {
             return result_type{};
         }
-        if (val.is_ppq()) {
-            // MIDI always 4/4
-            return result_type{static_cast<result_type::rep>(60.0 / (val.ppq() * bpm.bpm_fp()) * 1'000'000'000)};
+        return result_type{static_cast<result_type::rep>(details::mul_div(ticks, ratio.num, ratio.den))};
+    }
+
+    /// \brief Count of whole ticks in \a duration, inverse of ticks_to_duration
+    constexpr uint64_t duration_to_ticks(division val, tempo bpm, std::chrono::nanoseconds duration) noexcept
+    {
+        const auto ratio = details::division_tick_ratio(val, bpm);
+        if (ratio.num == 0 || duration <= std::chrono::nanoseconds{}) {
+            return 0;
         }
-        // 24 25 29(.97) 30
-        double realfps = val.fps();
-        if (val.fps() == 29) {
-            realfps = 29.97;
+        const auto ns    = static_cast<uint64_t>(duration.count());
+        uint64_t   ticks = details::mul_div(ns, ratio.den, ratio.num);
+        while (details::mul_div(ticks + 1, ratio.num, ratio.den) <= ns) { // rounding of mul_div
+            ++ticks;
         }
-        return result_type{static_cast<result_type::rep>(1 / (realfps * val.tpf()) * 1'000'000'000)};
+        return ticks;
+    }
+
+    /// \brief Duration of one tick, truncated to nanoseconds
+    ///
+    /// \note Prefer ticks_to_duration to multiplying this.
+    constexpr std::chrono::nanoseconds division_to_duration(division val, tempo bpm) noexcept
+    {
+        return ticks_to_duration(val, bpm, 1);
+    }
+
+    /// \brief hh:mm:ss:ff SMPTE time code
+    struct smpte_timecode {
+        uint8_t hours;
+        uint8_t minutes;
+        uint8_t seconds;
+        uint8_t frames;
+
+        friend constexpr bool operator==(const smpte_timecode&, const smpte_timecode&) noexcept = default;
+    };
+
+    /// \brief Frames counted in a second of time code, 30 for 29 (drop frame)
+    constexpr uint8_t smpte_nominal_fps(uint8_t fps) noexcept
+    {
+        return fps == 29 ? 30 : fps;
+    }
+
+    /// \brief Time code of the \a frame -th frame, hours wrap at 24
+    /// \param fps 24, 25, 29 or 30, 29 means 29.97 drop frame: frame 0 and 1 of every
+    /// minute are skipped except every tenth minute
+    constexpr smpte_timecode frames_to_timecode(uint64_t frame, uint8_t fps) noexcept
+    {
+        if (fps == 29) {
+            constexpr uint64_t frames_per_10min = (10 * 60 * 30) - (9 * 2);
+            constexpr uint64_t frames_per_min   = (60 * 30) - 2;
+
+            const uint64_t tens = frame / frames_per_10min;
+            const uint64_t rest = frame % frames_per_10min;
+            frame += (18 * tens) + (rest < 2 ? 0 : 2 * ((rest - 2) / frames_per_min));
+        }
+        const uint64_t nominal = smpte_nominal_fps(fps);
+        if (nominal == 0) {
+            return {};
+        }
+        return {
+            static_cast<uint8_t>(frame / (nominal * 3600) % 24),
+            static_cast<uint8_t>(frame / (nominal * 60) % 60),
+            static_cast<uint8_t>(frame / nominal % 60),
+            static_cast<uint8_t>(frame % nominal),
+        };
+    }
+
+    /// \brief Frame number of \a code, inverse of frames_to_timecode
+    constexpr uint64_t timecode_to_frames(smpte_timecode code, uint8_t fps) noexcept
+    {
+        const uint64_t nominal = smpte_nominal_fps(fps);
+        const uint64_t minutes = (uint64_t{code.hours} * 60) + code.minutes;
+        uint64_t       frame   = (((minutes * 60) + code.seconds) * nominal) + code.frames;
+        if (fps == 29) {
+            frame -= 2 * (minutes - (minutes / 10));
+        }
+        return frame;
+    }
+
+    /// \brief Exact duration of \a frames frames, 29 means 30000/1001 fps
+    constexpr std::chrono::nanoseconds frames_to_duration(uint64_t frames, uint8_t fps) noexcept
+    {
+        return ticks_to_duration(division{fps, 1}, tempo{}, frames);
     }
 }
\ No newline at end of file
@@ -0,0 +1,169 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/// \file load_smf.hpp
+/// \brief Validate and index every track of a SMF concurrently
+
+#pragma once
+
+#include "mfmidi/midi_tempo.hpp"
+#include "mfmidi/smf/span_track.hpp"
+#include "mfmidi/smf/span_track_index.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <exception>
+#include <functional>
+#include <latch>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace mfmidi {
+    struct smf_tempo_event {
+        uint64_t tick;  ///< absolute tick
+        tempo    tempo;
+        uint16_t track; ///< track which contains the event
+    };
+
+    struct load_smf_result {
+        smf_header                    info;
+        std::vector<span_track_index> tracks;       ///< event count of a track is its size()
+        std::vector<smf_tempo_event>  tempo_events; ///< sorted by tick, then by track
+    };
+
+    /// \brief Something that runs a task, probably later on another thread
+    template <class T>
+    concept smf_load_executor = requires(T& executor, std::function<void()> task) {
+        executor(std::move(task));
+    };
+
+    namespace details {
+        inline void load_smf_track(load_smf_result& result, std::vector<std::vector<smf_tempo_event>>& tempos, const parse_smf_header_result& header, size_t index, size_t stride)
+        {
+            auto& found = tempos[index];
+            auto  visit = [&](const span_track::iterator& it, uint64_t tick) {
+                if (it.running_status() == MIDIMsgStatus::META_EVENT) { // only decode meta events
+                    auto msg = *it;
+                    if (msg.is_tempo()) {
+                        found.push_back({tick, msg.tempo(), static_cast<uint16_t>(index)});
+                    }
+                }
+            };
+            result.tracks[index] = span_track_index{span_track{header.tracks[index]}, stride, visit};
+        }
+
+        inline void merge_tempo_events(load_smf_result& result, std::vector<std::vector<smf_tempo_event>>& tempos)
+        {
+            for (auto& found : tempos) {
+                result.tempo_events.insert(result.tempo_events.end(), found.begin(), found.end());
+            }
+            std::ranges::stable_sort(result.tempo_events, {}, &smf_tempo_event::tick);
+        }
+    }
+
+    /// \brief Validate and index every track, one task per track
+    ///
+    /// Every task is submitted to \a executor, which decides how they are spread
+    /// over threads. This function blocks until all tasks finished, and rethrows the
+    /// first error thrown by any of them. If \a executor throws, the tasks submitted
+    /// before are waited for, then its exception is rethrown.
+    ///
+    /// \param file The entire SMF file, must outlive the result
+    /// \param stride Index stride, see span_track_index
+    template <smf_load_executor Executor>
+    [[nodiscard]] load_smf_result load_smf_parallel(std::span<const uint8_t> file, Executor&& executor, size_t stride = 1)
+    {
+        auto            header = parse_smf_header(file);
+        load_smf_result result{.info = header.info, .tracks = std::vector<span_track_index>(header.tracks.size()), .tempo_events = {}};
+
+        std::vector<std::vector<smf_tempo_event>> tempos(header.tracks.size());
+        std::latch                                done{static_cast<std::ptrdiff_t>(header.tracks.size())};
+        std::exception_ptr                        error;
+        std::once_flag                            error_flag;
+
+        size_t submitted = 0;
+        try {
+            for (; submitted < header.tracks.size(); ++submitted) {
+                executor([&, index = submitted] {
+                    try {
+                        details::load_smf_track(result, tempos, header, index, stride);
+                    } catch (...) {
+                        std::call_once(error_flag, [&] { error = std::current_exception(); });
+                    }
+                    done.count_down();
+                });
+            }
+        } catch (...) {
+            // submitted tasks still use the locals, wait for them
+            done.count_down(static_cast<std::ptrdiff_t>(header.tracks.size() - submitted));
+            done.wait();
+            throw;
+        }
+        done.wait();
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        details::merge_tempo_events(result, tempos);
+        return result;
+    }
+
+    /// \brief Validate and index every track on \a threads worker threads
+    ///
+    /// Workers take the next unprocessed track when they finish one, so a few huge
+    /// tracks do not leave the other workers idle.
+    [[nodiscard]] inline load_smf_result load_smf_parallel(std::span<const uint8_t> file, unsigned threads = std::thread::hardware_concurrency(), size_t stride = 1)
+    {
+        auto            header = parse_smf_header(file);
+        load_smf_result result{.info = header.info, .tracks = std::vector<span_track_index>(header.tracks.size()), .tempo_events = {}};
+
+        std::vector<std::vector<smf_tempo_event>> tempos(header.tracks.size());
+        std::atomic<size_t>                       next{0};
+        std::exception_ptr                        error;
+        std::once_flag                            error_flag;
+
+        auto worker = [&] {
+            for (size_t index = next++; index < header.tracks.size(); index = next++) {
+                try {
+                    details::load_smf_track(result, tempos, header, index, stride);
+                } catch (...) {
+                    std::call_once(error_flag, [&] { error = std::current_exception(); });
+                    next = header.tracks.size(); // stop other workers early
+                }
+            }
+        };
+
+        {
+            threads = std::clamp<unsigned>(threads, 1U, std::max<unsigned>(static_cast<unsigned>(header.tracks.size()), 1U));
+            std::vector<std::jthread> workers;
+            workers.reserve(threads - 1);
+            for (unsigned i = 1; i < threads; ++i) {
+                workers.emplace_back(worker);
+            }
+            worker(); // the calling thread works too
+        }
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        details::merge_tempo_events(result, tempos);
+        return result;
+    }
+}
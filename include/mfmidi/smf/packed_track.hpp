@@ -0,0 +1,317 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/// \file packed_track.hpp
+/// \brief Struct-of-arrays track
+
+#pragma once
+
+#include "mfmidi/midi_message.hpp"
+#include "mfmidi/smf/span_track.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <compare>
+#include <iterator>
+#include <ranges>
+#include <span>
+#include <vector>
+
+namespace mfmidi {
+    /// \brief A track decoded once into column arrays
+    ///
+    /// Channel messages live in the \c status, \c data1 and \c data2 columns (missing
+    /// data bytes are stored as 0). Other messages (meta, sysex...) are copied as a whole
+    /// into a side arena and referenced by event index. Scans over a single column are
+    /// cache friendly and vectorizable.
+    class packed_track {
+    public:
+        using value_type = const foreign_midi_message;
+
+        class iterator {
+            friend packed_track;
+
+            const packed_track* _track{};
+            size_t              _pos{};
+
+            constexpr iterator(const packed_track* track, size_t pos) noexcept
+                : _track(track)
+                , _pos(pos)
+            {
+            }
+
+        public:
+            using iterator_concept  = std::random_access_iterator_tag;
+            using iterator_category = std::input_iterator_tag; // dereference returns prvalue
+            using difference_type   = std::ptrdiff_t;
+            using value_type        = const foreign_midi_message;
+
+            constexpr iterator() noexcept = default;
+
+            foreign_midi_message operator*() const
+            {
+                return (*_track)[_pos];
+            }
+
+            foreign_midi_message operator[](difference_type n) const
+            {
+                return (*_track)[_pos + n];
+            }
+
+            /// \brief Absolute tick of current event
+            [[nodiscard]] uint64_t tick() const noexcept
+            {
+                return _track->_tick[_pos];
+            }
+
+            /// \brief Position of current event in the track
+            [[nodiscard]] constexpr size_t index() const noexcept
+            {
+                return _pos;
+            }
+
+            constexpr iterator& operator++() noexcept
+            {
+                ++_pos;
+                return *this;
+            }
+
+            constexpr iterator operator++(int) noexcept
+            {
+                auto old = *this;
+                ++_pos;
+                return old;
+            }
+
+            constexpr iterator& operator--() noexcept
+            {
+                --_pos;
+                return *this;
+            }
+
+            constexpr iterator operator--(int) noexcept
+            {
+                auto old = *this;
+                --_pos;
+                return old;
+            }
+
+            constexpr iterator& operator+=(difference_type n) noexcept
+            {
+                _pos += n;
+                return *this;
+            }
+
+            constexpr iterator& operator-=(difference_type n) noexcept
+            {
+                _pos -= n;
+                return *this;
+            }
+
+            friend constexpr iterator operator+(iterator it, difference_type n) noexcept
+            {
+                return it += n;
+            }
+
+            friend constexpr iterator operator+(difference_type n, iterator it) noexcept
+            {
+                return it += n;
+            }
+
+            friend constexpr iterator operator-(iterator it, difference_type n) noexcept
+            {
+                return it -= n;
+            }
+
+            friend constexpr difference_type operator-(const iterator& lhs, const iterator& rhs) noexcept
+            {
+                return static_cast<difference_type>(lhs._pos) - static_cast<difference_type>(rhs._pos);
+            }
+
+            friend constexpr bool operator==(const iterator& lhs, const iterator& rhs) noexcept
+            {
+                return lhs._pos == rhs._pos;
+            }
+
+            friend constexpr std::strong_ordering operator<=>(const iterator& lhs, const iterator& rhs) noexcept
+            {
+                return lhs._pos <=> rhs._pos;
+            }
+        };
+
+        packed_track() = default;
+
+        /// \brief Decode a track of timed messages, such as span_track
+        template <std::ranges::input_range R>
+            requires std::ranges::contiguous_range<std::ranges::range_value_t<R>> && requires(std::ranges::range_value_t<R> msg) {
+                {
+                    msg.delta_time()
+                } -> std::convertible_to<uint_midi_time>;
+            }
+        explicit packed_track(R&& track)
+        {
+            if constexpr (std::ranges::sized_range<R>) {
+                reserve(std::ranges::size(track));
+            }
+            for (auto&& msg : track) {
+                push_back(msg.delta_time(), std::span<const uint8_t>{std::ranges::data(msg), std::ranges::size(msg)});
+            }
+            shrink_to_fit();
+        }
+
+        void reserve(size_t count)
+        {
+            _delta.reserve(count);
+            _tick.reserve(count);
+            _status.reserve(count);
+            _data1.reserve(count);
+            _data2.reserve(count);
+        }
+
+        void shrink_to_fit()
+        {
+            _delta.shrink_to_fit();
+            _tick.shrink_to_fit();
+            _status.shrink_to_fit();
+            _data1.shrink_to_fit();
+            _data2.shrink_to_fit();
+            _arena.shrink_to_fit();
+            _payloads.shrink_to_fit();
+        }
+
+        void push_back(uint_midi_time delta, std::span<const uint8_t> msg)
+        {
+            assert(!msg.empty());
+            const uint8_t status = msg[0];
+            const bool    packed = status >= MIDIMsgStatus::NOTE_OFF && status < MIDIMsgStatus::SYSEX_START;
+            const auto    index  = static_cast<uint32_t>(_delta.size());
+
+            _delta.push_back(delta);
+            _tick.push_back((_tick.empty() ? 0 : _tick.back()) + delta);
+            _status.push_back(status);
+            _data1.push_back(packed && msg.size() > 1 ? msg[1] : 0);
+            _data2.push_back(packed && msg.size() > 2 ? msg[2] : 0);
+            if (!packed) {
+                _payloads.push_back({index, static_cast<uint32_t>(_arena.size()), static_cast<uint32_t>(msg.size())});
+                _arena.insert(_arena.end(), msg.begin(), msg.end());
+            }
+        }
+
+        foreign_midi_message operator[](size_t pos) const
+        {
+            assert(pos < size());
+            foreign_midi_message event;
+            event.set_delta_time(_delta[pos]);
+            const uint8_t status = _status[pos];
+            if (status >= MIDIMsgStatus::NOTE_OFF && status < MIDIMsgStatus::SYSEX_START) {
+                const uint8_t bytes[]{status, _data1[pos], _data2[pos]};
+
+                foreign_midi_message::base_type::inline_type small;
+                small.append(bytes, expected_channel_message_length(status));
+                event.base() = small;
+            } else {
+                event.base() = payload(pos);
+            }
+            return event;
+        }
+
+        /// \brief Raw bytes of a message stored in the arena, empty for packed channel messages
+        [[nodiscard]] std::span<const uint8_t> payload(size_t pos) const
+        {
+            auto found = std::ranges::lower_bound(_payloads, static_cast<uint32_t>(pos), {}, &payload_ref::event);
+            if (found == _payloads.end() || found->event != pos) {
+                return {};
+            }
+            return {_arena.data() + found->offset, found->size};
+        }
+
+        [[nodiscard]] iterator begin() const noexcept
+        {
+            return {this, 0};
+        }
+
+        [[nodiscard]] iterator end() const noexcept
+        {
+            return {this, size()};
+        }
+
+        [[nodiscard]] size_t size() const noexcept
+        {
+            return _delta.size();
+        }
+
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return _delta.empty();
+        }
+
+        /// \brief Find the first event whose absolute tick is not less than \a tick
+        [[nodiscard]] iterator lower_bound(uint64_t tick) const noexcept
+        {
+            return {this, static_cast<size_t>(std::ranges::lower_bound(_tick, tick) - _tick.begin())};
+        }
+
+        /// \name Columns
+        /// \{
+
+        [[nodiscard]] std::span<const uint32_t> deltas() const noexcept
+        {
+            return _delta;
+        }
+
+        [[nodiscard]] std::span<const uint64_t> ticks() const noexcept
+        {
+            return _tick;
+        }
+
+        [[nodiscard]] std::span<const uint8_t> statuses() const noexcept
+        {
+            return _status;
+        }
+
+        [[nodiscard]] std::span<const uint8_t> data1() const noexcept
+        {
+            return _data1;
+        }
+
+        [[nodiscard]] std::span<const uint8_t> data2() const noexcept
+        {
+            return _data2;
+        }
+
+        /// \}
+
+    private:
+        struct payload_ref {
+            uint32_t event;
+            uint32_t offset;
+            uint32_t size;
+        };
+
+        std::vector<uint32_t>    _delta;
+        std::vector<uint64_t>    _tick;
+        std::vector<uint8_t>     _status;
+        std::vector<uint8_t>     _data1;
+        std::vector<uint8_t>     _data2;
+        std::vector<uint8_t>     _arena;
+        std::vector<payload_ref> _payloads; // sorted by event
+    };
+
+    static_assert(std::random_access_iterator<packed_track::iterator>);
+    static_assert(std::ranges::random_access_range<packed_track>);
+    static_assert(std::ranges::sized_range<packed_track>);
+}
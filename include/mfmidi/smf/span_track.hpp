@@ -61,12 +61,35 @@ namespace mfmidi {
 
             iterator() noexcept = default;
 
+            /// \brief Delta time of current message, without building it
+            [[nodiscard]] uint_midi_time delta_time() const noexcept
+            {
+                return _delta_time;
+            }
+
+            /// \brief Position of the next message (its delta time) in the track chunk
+            [[nodiscard]] const uint8_t* next_position() const noexcept
+            {
+                return _current;
+            }
+
+            /// \brief Running status in effect for the next message
+            [[nodiscard]] uint8_t running_status() const noexcept
+            {
+                return _status;
+            }
+
             foreign_midi_message operator*() const
             {
                 assert(_begin != nullptr);
                 foreign_midi_message event;
                 event.set_delta_time(_delta_time);
-                if (_running_status) {
+                if (_running_status && _len <= foreign_midi_message::base_type::inline_type::capacity()) {
+                    foreign_midi_message::base_type::inline_type small;
+                    small.push_back(_status);
+                    small.append(_begin, _len - 1);
+                    event.base() = small;
+                } else if (_running_status) {
                     foreign_midi_message::base_type::own_type own;
                     own.reserve(_len);
                     own.push_back(_status);
@@ -192,7 +215,7 @@ namespace mfmidi {
 
             std::pair<uint32_t, size_t> readVarNum()
             {
-                auto result = read_smf_variable_length_number(std::ranges::subrange{_current, (&_base.back()) + 1});
+                auto result = read_smf_variable_length_number(_current, (&_base.back()) + 1);
                 _current    = result.it;
                 return {result.result, result.size};
             }
@@ -228,6 +251,17 @@ namespace mfmidi {
             return {};
         }
 
+        /// \brief Resume reading at a known message
+        /// \param position Position of the message (its delta time) in the track chunk
+        /// \param running_status Running status in effect before the message
+        [[nodiscard]] iterator iterator_at(const uint8_t* position, uint8_t running_status) const
+        {
+            assert(position >= _base.data() && position < _base.data() + _base.size());
+            iterator it{_base, position, running_status};
+            ++it;
+            return it;
+        }
+
     private:
         base_type _base;
     };
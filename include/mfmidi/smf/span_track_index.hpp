@@ -0,0 +1,301 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/// \file span_track_index.hpp
+/// \brief Random access on span_track
+
+#pragma once
+
+#include "mfmidi/smf/span_track.hpp"
+#include <algorithm>
+#include <cassert>
+#include <compare>
+#include <iterator>
+#include <ranges>
+#include <utility>
+#include <vector>
+
+namespace mfmidi {
+    /// \brief Event offset index of a span_track
+    ///
+    /// Built once per track, it records where every \a stride -th event begins, so
+    /// the track becomes a random access range. Accessing an event costs at most
+    /// \a stride - 1 parses after the nearest checkpoint.
+    class span_track_index {
+    public:
+        struct checkpoint {
+            uint64_t tick;           ///< absolute tick of the event
+            uint32_t offset;         ///< offset of the event (its delta time) in the track chunk
+            uint8_t  running_status; ///< running status before the event
+        };
+
+        class iterator {
+            friend span_track_index;
+
+            const span_track_index* _index{};
+            size_t                  _pos{};
+            span_track::iterator    _it{};
+            uint64_t                _tick{};
+
+        public:
+            using iterator_concept  = std::random_access_iterator_tag;
+            using iterator_category = std::input_iterator_tag; // dereference returns prvalue
+            using difference_type   = std::ptrdiff_t;
+            using value_type        = const foreign_midi_message;
+
+            iterator() noexcept = default;
+
+            foreign_midi_message operator*() const
+            {
+                assert(_index != nullptr && _pos < _index->_size);
+                return *_it;
+            }
+
+            foreign_midi_message operator[](difference_type n) const
+            {
+                return *(*this + n);
+            }
+
+            /// \brief Absolute tick of current event
+            [[nodiscard]] uint64_t tick() const noexcept
+            {
+                return _tick;
+            }
+
+            /// \brief Position of current event in the track
+            [[nodiscard]] size_t index() const noexcept
+            {
+                return _pos;
+            }
+
+            /// \brief Delta time of current event, without building it
+            [[nodiscard]] uint_midi_time delta_time() const noexcept
+            {
+                return _it.delta_time();
+            }
+
+            /// \brief Status of current event, without building it
+            [[nodiscard]] uint8_t running_status() const noexcept
+            {
+                return _it.running_status();
+            }
+
+            [[nodiscard]] const span_track::iterator& base() const noexcept
+            {
+                return _it;
+            }
+
+            iterator& operator++()
+            {
+                assert(_index != nullptr && _pos < _index->_size);
+                ++_pos;
+                if (_pos < _index->_size) {
+                    ++_it;
+                    _tick += _it.delta_time();
+                }
+                return *this;
+            }
+
+            iterator operator++(int)
+            {
+                auto old = *this;
+                ++*this;
+                return old;
+            }
+
+            iterator& operator--()
+            {
+                return *this -= 1;
+            }
+
+            iterator operator--(int)
+            {
+                auto old = *this;
+                --*this;
+                return old;
+            }
+
+            iterator& operator+=(difference_type n)
+            {
+                assert(_index != nullptr);
+                const auto target = static_cast<size_t>(static_cast<difference_type>(_pos) + n);
+                assert(target <= _index->_size);
+                if (target >= _index->_size) {
+                    _pos = target;
+                    return *this;
+                }
+                const size_t stride = _index->_stride;
+                if (target >= _pos && _pos < _index->_size && target / stride == _pos / stride) {
+                    while (_pos != target) {
+                        ++*this;
+                    }
+                } else {
+                    seek(target);
+                }
+                return *this;
+            }
+
+            iterator& operator-=(difference_type n)
+            {
+                return *this += -n;
+            }
+
+            friend iterator operator+(iterator it, difference_type n)
+            {
+                return it += n;
+            }
+
+            friend iterator operator+(difference_type n, iterator it)
+            {
+                return it += n;
+            }
+
+            friend iterator operator-(iterator it, difference_type n)
+            {
+                return it -= n;
+            }
+
+            friend difference_type operator-(const iterator& lhs, const iterator& rhs) noexcept
+            {
+                return static_cast<difference_type>(lhs._pos) - static_cast<difference_type>(rhs._pos);
+            }
+
+            friend bool operator==(const iterator& lhs, const iterator& rhs) noexcept
+            {
+                return lhs._pos == rhs._pos;
+            }
+
+            friend std::strong_ordering operator<=>(const iterator& lhs, const iterator& rhs) noexcept
+            {
+                return lhs._pos <=> rhs._pos;
+            }
+
+        protected:
+            iterator(const span_track_index* index, size_t pos)
+                : _index(index)
+                , _pos(pos)
+            {
+                if (pos < index->_size) {
+                    seek(pos);
+                }
+            }
+
+            void seek(size_t pos)
+            {
+                const size_t      stride = _index->_stride;
+                const checkpoint& cp     = _index->_checkpoints[pos / stride];
+                _it                      = _index->_track.iterator_at(_index->_track.base().data() + cp.offset, cp.running_status);
+                _tick                    = cp.tick;
+                for (_pos = pos / stride * stride; _pos != pos;) {
+                    ++*this;
+                }
+            }
+        };
+
+        span_track_index() noexcept = default;
+
+        /// \param track The track to index
+        /// \param stride Record every \a stride -th event, 1 to record all
+        explicit span_track_index(span_track track, size_t stride = 1)
+            : span_track_index(track, stride, [](const span_track::iterator& /*unused*/, uint64_t /*unused*/) {})
+        {
+        }
+
+        /// \param visitor Called as \c visitor(it, tick) on every event while indexing
+        template <std::invocable<const span_track::iterator&, uint64_t> Visitor>
+        span_track_index(span_track track, size_t stride, Visitor&& visitor)
+            : _track(track)
+            , _stride(std::max<size_t>(stride, 1))
+        {
+            const auto& base = _track.base();
+            if (base.empty()) {
+                return;
+            }
+            const uint8_t* position = base.data() + 8; // MTrk <len 4 bytes>
+            uint8_t        status   = 0;
+            uint64_t       tick     = 0;
+            for (auto it = _track.begin(); it != _track.end(); ++it) {
+                tick += it.delta_time();
+                if (_size % _stride == 0) {
+                    _checkpoints.push_back({tick, static_cast<uint32_t>(position - base.data()), status});
+                }
+                visitor(std::as_const(it), tick);
+                ++_size;
+                position = it.next_position();
+                status   = it.running_status();
+            }
+        }
+
+        [[nodiscard]] iterator begin() const
+        {
+            return iterator{this, 0};
+        }
+
+        [[nodiscard]] iterator end() const
+        {
+            return iterator{this, _size};
+        }
+
+        [[nodiscard]] size_t size() const noexcept
+        {
+            return _size;
+        }
+
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return _size == 0;
+        }
+
+        [[nodiscard]] size_t stride() const noexcept
+        {
+            return _stride;
+        }
+
+        [[nodiscard]] const span_track& track() const noexcept
+        {
+            return _track;
+        }
+
+        [[nodiscard]] const std::vector<checkpoint>& checkpoints() const noexcept
+        {
+            return _checkpoints;
+        }
+
+        /// \brief Find the first event whose absolute tick is not less than \a tick
+        [[nodiscard]] iterator lower_bound(uint64_t tick) const
+        {
+            auto   found = std::ranges::partition_point(_checkpoints, [tick](const checkpoint& cp) { return cp.tick < tick; });
+            size_t block = found - _checkpoints.begin();
+            auto   it    = iterator{this, block == 0 ? 0 : (block - 1) * _stride};
+            auto   last  = end();
+            while (it != last && it.tick() < tick) {
+                ++it;
+            }
+            return it;
+        }
+
+    private:
+        span_track              _track{span_track::base_type{}};
+        size_t                  _stride = 1;
+        size_t                  _size   = 0;
+        std::vector<checkpoint> _checkpoints;
+    };
+
+    static_assert(std::random_access_iterator<span_track_index::iterator>);
+    static_assert(std::ranges::random_access_range<span_track_index>);
+    static_assert(std::ranges::sized_range<span_track_index>);
+}
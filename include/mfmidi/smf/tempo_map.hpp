@@ -0,0 +1,201 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/// \file tempo_map.hpp
+/// \brief Tick to time conversion of a whole SMF
+
+#pragma once
+
+#include "mfmidi/midi_tempo.hpp"
+#include "mfmidi/smf/division.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <ranges>
+#include <stdexcept>
+#include <vector>
+
+namespace mfmidi {
+    /// \brief Tempo segments of a SMF, with their absolute tick and time
+    ///
+    /// Built once from the conductor track(s), then shared by every playhead: tempo
+    /// changes no longer need to be broadcast and applied while playing.
+    class tempo_map {
+    public:
+        using Time = std::chrono::nanoseconds;
+
+        struct segment {
+            uint64_t      tick; ///< first tick of the segment
+            Time          time; ///< time of \c tick
+            mfmidi::tempo tempo;
+        };
+
+        /// \brief Sequential lookup, amortized O(1) when ticks do not decrease
+        class cursor {
+            const tempo_map* _map{};
+            size_t           _index{};
+
+        public:
+            cursor() noexcept = default;
+
+            explicit cursor(const tempo_map& map) noexcept
+                : _map(&map)
+            {
+            }
+
+            Time tick_to_time(uint64_t tick) noexcept
+            {
+                assert(_map != nullptr);
+                const auto& segments = _map->_segments;
+                if (tick < segments[_index].tick) {
+                    _index = _map->segment_index_at_tick(tick);
+                } else {
+                    while (_index + 1 < segments.size() && segments[_index + 1].tick <= tick) {
+                        ++_index;
+                    }
+                }
+                return _map->time_in_segment(segments[_index], tick);
+            }
+
+            [[nodiscard]] const segment& current() const noexcept
+            {
+                assert(_map != nullptr);
+                return _map->_segments[_index];
+            }
+
+            [[nodiscard]] const tempo_map* map() const noexcept
+            {
+                return _map;
+            }
+        };
+
+        tempo_map()
+            : tempo_map(mfmidi::division{}, 120_bpm)
+        {
+        }
+
+        explicit tempo_map(mfmidi::division division, mfmidi::tempo initial = 120_bpm)
+            : _division(division)
+        {
+            _segments.push_back({0, Time{}, initial});
+        }
+
+        /// \brief Build from tempo events sorted by tick, such as load_smf_result::tempo_events
+        template <std::ranges::input_range R>
+            requires requires(std::ranges::range_reference_t<R> event) {
+                {
+                    event.tick
+                } -> std::convertible_to<uint64_t>;
+                {
+                    event.tempo
+                } -> std::convertible_to<mfmidi::tempo>;
+            }
+        tempo_map(mfmidi::division division, R&& events, mfmidi::tempo initial = 120_bpm)
+            : tempo_map(division, initial)
+        {
+            for (auto&& event : events) {
+                add(event.tick, event.tempo);
+            }
+        }
+
+        /// \brief Build from a track of timed messages, such as span_track
+        template <std::ranges::input_range Track>
+        [[nodiscard]] static tempo_map from_track(mfmidi::division division, const Track& track, mfmidi::tempo initial = 120_bpm)
+        {
+            tempo_map result{division, initial};
+            uint64_t  tick = 0;
+            for (auto&& msg : track) {
+                tick += msg.delta_time();
+                if (msg.is_tempo()) {
+                    result.add(tick, msg.tempo());
+                }
+            }
+            return result;
+        }
+
+        /// \brief Append a tempo change
+        /// \throw std::invalid_argument \a tick is less than the last change
+        void add(uint64_t tick, mfmidi::tempo tempo)
+        {
+            segment& last = _segments.back();
+            if (tick < last.tick) {
+                throw std::invalid_argument{"tempo_map::add: tempo changes must be sorted by tick"};
+            }
+            const segment next{tick, time_in_segment(last, tick), tempo};
+            if (tick == last.tick) {
+                last = next; // the later one wins
+            } else {
+                _segments.push_back(next);
+            }
+        }
+
+        /// \brief Time of \a tick, O(log n)
+        [[nodiscard]] Time tick_to_time(uint64_t tick) const noexcept
+        {
+            return time_in_segment(_segments[segment_index_at_tick(tick)], tick);
+        }
+
+        /// \brief Last tick which is not later than \a time, O(log n)
+        [[nodiscard]] uint64_t time_to_tick(Time time) const noexcept
+        {
+            if (time <= Time{}) {
+                return 0;
+            }
+            auto           found = std::ranges::partition_point(_segments, [time](const segment& seg) { return seg.time <= time; });
+            const segment& seg   = *std::prev(found);
+            return seg.tick + duration_to_ticks(_division, seg.tempo, time - seg.time);
+        }
+
+        /// \brief Tempo in effect at \a tick
+        [[nodiscard]] mfmidi::tempo tempo_at(uint64_t tick) const noexcept
+        {
+            return _segments[segment_index_at_tick(tick)].tempo;
+        }
+
+        [[nodiscard]] cursor make_cursor() const noexcept
+        {
+            return cursor{*this};
+        }
+
+        [[nodiscard]] mfmidi::division division() const noexcept
+        {
+            return _division;
+        }
+
+        /// \brief Segments sorted by tick, never empty
+        [[nodiscard]] const std::vector<segment>& segments() const noexcept
+        {
+            return _segments;
+        }
+
+    private:
+        mfmidi::division     _division{};
+        std::vector<segment> _segments;
+
+        [[nodiscard]] size_t segment_index_at_tick(uint64_t tick) const noexcept
+        {
+            auto found = std::ranges::partition_point(_segments, [tick](const segment& seg) { return seg.tick <= tick; });
+            return found - _segments.begin() - 1; // first segment is at tick 0
+        }
+
+        [[nodiscard]] Time time_in_segment(const segment& seg, uint64_t tick) const noexcept
+        {
+            return seg.time + ticks_to_duration(_division, seg.tempo, tick - seg.tick);
+        }
+    };
+}
@@ -22,7 +22,9 @@
 #include <bit>
 #include <cassert>
 #include <climits>
+#include <cstring>
 #include <ranges>
+#include <stdexcept>
 
 namespace mfmidi {
     template <std::unsigned_integral T, std::regular V>
@@ -129,7 +131,7 @@ namespace mfmidi {
                 ++it;
                 return _read_smf_variable_length_number_result<std::ranges::iterator_t<R>>{result, std::move(it), sz};
             }
-            if (sz == 3) {
+            if (sz == 4) {
                 throw std::range_error{"read_smf_variable_length_number: overflow in 28 bits"};
             }
             result <<= 7;
@@ -137,6 +139,46 @@ namespace mfmidi {
         throw std::domain_error{"read_smf_variable_lengrh_number: early END"};
     }
 
+    namespace details {
+        /// \brief Combine the 7-bit groups of a variable length number of \a size bytes
+        /// \param word Little endian load of the bytes, only the low \a size bytes are used
+        constexpr uint32_t combine_smf_variable_length_number(uint32_t word, uint_fast8_t size) noexcept
+        {
+            assert(size >= 1 && size <= 4);
+            word &= static_cast<uint32_t>((uint64_t{1} << (size * 8U)) - 1) & 0x7F7F7F7FU;
+            word = std::byteswap(word) >> ((4U - size) * 8U); // first byte is most significant
+            return (word & 0x7FU) | ((word >> 1U) & 0x3F80U) | ((word >> 2U) & 0x1FC000U) | ((word >> 3U) & 0xFE00000U);
+        }
+
+        inline uint32_t load_u32_le(const uint8_t* ptr) noexcept
+        {
+            uint32_t word;
+            std::memcpy(&word, ptr, sizeof(word));
+            if constexpr (std::endian::native == std::endian::big) {
+                word = std::byteswap(word);
+            }
+            return word;
+        }
+    }
+
+    /// \brief Read a variable length number from contiguous bytes
+    ///
+    /// Same as read_smf_variable_length_number, but when 4 bytes are readable the
+    /// number is located and decoded from one word load without a branch per byte.
+    inline _read_smf_variable_length_number_result<const uint8_t*> read_smf_variable_length_number(const uint8_t* first, const uint8_t* last)
+    {
+        if (last - first < 4) {
+            return read_smf_variable_length_number(std::ranges::subrange{first, last});
+        }
+        const uint32_t word = details::load_u32_le(first);
+        const uint32_t term = ~word & 0x80808080U;
+        if (term == 0) {
+            throw std::range_error{"read_smf_variable_length_number: overflow in 28 bits"};
+        }
+        const auto size = static_cast<uint_fast8_t>((std::countr_zero(term) >> 3U) + 1);
+        return {details::combine_smf_variable_length_number(word, size), first + size, size};
+    }
+
     template <std::output_iterator<uint8_t> OutIt>
     constexpr size_t writeVarNumIt(uint32_t data, OutIt iter)
     {
@@ -0,0 +1,120 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/// \file spsc_ring.hpp
+/// \brief Lock-free single producer single consumer ring buffer
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace mfmidi {
+    /// \brief Bounded single producer single consumer FIFO
+    ///
+    /// Never allocates after construction. The capacity is rounded up to a power
+    /// of two. The producer records the highest fill level seen.
+    template <class T>
+    class spsc_ring {
+        std::vector<T> _buffer;
+        size_t         _mask;
+
+        alignas(64) std::atomic<size_t> _head{0}; // next to read, written by consumer
+        alignas(64) std::atomic<size_t> _tail{0}; // next to write, written by producer
+        alignas(64) std::atomic<size_t> _high_water{0};
+
+    public:
+        explicit spsc_ring(size_t capacity)
+            : _buffer(std::bit_ceil(std::max<size_t>(capacity, 2)))
+            , _mask(_buffer.size() - 1)
+        {
+        }
+
+        spsc_ring(const spsc_ring&)            = delete;
+        spsc_ring(spsc_ring&&)                 = delete;
+        spsc_ring& operator=(const spsc_ring&) = delete;
+        spsc_ring& operator=(spsc_ring&&)      = delete;
+
+        /// \brief Producer only
+        /// \return false if full
+        bool try_push(const T& value) noexcept(std::is_nothrow_copy_assignable_v<T>)
+        {
+            const size_t tail = _tail.load(std::memory_order_relaxed);
+            const size_t head = _head.load(std::memory_order_acquire);
+            if (tail - head == capacity()) {
+                return false;
+            }
+            _buffer[tail & _mask] = value;
+            _tail.store(tail + 1, std::memory_order_release);
+
+            const size_t used = tail + 1 - head;
+            size_t       seen = _high_water.load(std::memory_order_relaxed);
+            while (used > seen && !_high_water.compare_exchange_weak(seen, used, std::memory_order_relaxed)) {
+            }
+            return true;
+        }
+
+        /// \brief Producer only, free slots which are guaranteed for try_push
+        [[nodiscard]] size_t free_space() const noexcept
+        {
+            return capacity() - (_tail.load(std::memory_order_relaxed) - _head.load(std::memory_order_acquire));
+        }
+
+        /// \brief Consumer only
+        /// \return false if empty
+        bool try_pop(T& value) noexcept(std::is_nothrow_copy_assignable_v<T>)
+        {
+            const size_t head = _head.load(std::memory_order_relaxed);
+            if (head == _tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+            value = _buffer[head & _mask];
+            _head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        [[nodiscard]] size_t size() const noexcept
+        {
+            return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+        }
+
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return size() == 0;
+        }
+
+        [[nodiscard]] size_t capacity() const noexcept
+        {
+            return _buffer.size();
+        }
+
+        /// \brief Highest number of elements seen in the ring
+        [[nodiscard]] size_t high_water_mark() const noexcept
+        {
+            return _high_water.load(std::memory_order_relaxed);
+        }
+
+        void reset_high_water_mark() noexcept
+        {
+            _high_water.store(0, std::memory_order_relaxed);
+        }
+    };
+}
@@ -18,6 +18,8 @@
 #pragma once
 
 #include <chrono>
+#include <cstddef>
+#include <vector>
 
 namespace mfmidi {
     /// \brief mfmidi's nanosleep
@@ -26,11 +28,49 @@ namespace mfmidi {
     /// \return int 0 if succeeded
     int nanosleep(std::chrono::nanoseconds nsec);
 
+    /// \brief Sleep until hiresticktime() reaches \a deadline
+    ///
+    /// Unlike nanosleep, oversleeping does not delay the next deadline.
+    ///
+    /// \param deadline time stamp in nanoseconds, as returned by hiresticktime
+    /// \return int 0 if succeeded
+    int sleep_until(std::chrono::nanoseconds deadline);
+
     /// \brief Get high resolution time stamp in nanoseconds
     ///
+    /// Monotonic wall time, it keeps running while the thread sleeps.
+    ///
     /// \return unsigned long long time stamp in nanoseconds
     std::chrono::nanoseconds hiresticktime();
 
     int enable_thread_responsiveness();
     int disable_thread_responsiveness();
+
+    /// \brief Real-time setup of a player thread
+    struct player_thread_options {
+        enum class scheduling_policy {
+            normal,     ///< keep the default policy
+            fifo,       ///< SCHED_FIFO, time critical priority on Windows
+            round_robin ///< SCHED_RR, time critical priority on Windows
+        };
+
+        scheduling_policy policy = scheduling_policy::normal;
+        int               priority = 0; ///< clamped to the range of \c policy, 0 for the middle of it
+
+        std::vector<unsigned> cpus; ///< CPUs the thread may run on, empty for any
+
+        bool        lock_memory   = false; ///< mlockall current and future pages of the process
+        std::size_t prefault_stack = 0;    ///< bytes of stack to touch, so page faults happen now; more than the free stack is clamped and fails with ERANGE
+    };
+
+    /// \brief Apply \a options to the calling thread
+    ///
+    /// Every option is tried even if a previous one failed. Real-time policies and
+    /// locking memory usually need privileges (CAP_SYS_NICE, CAP_IPC_LOCK or rlimits).
+    ///
+    /// \return int 0 if succeeded, otherwise the error code of the first failure
+    int apply_thread_options(const player_thread_options& options);
+
+    /// \brief Touch every page of \a data, so page faults happen now
+    void prefault_memory(void* data, std::size_t size) noexcept;
 }
@@ -18,76 +18,235 @@
 #pragma once
 
 #include "mfmidi/event.hpp"
+#include "mfmidi/midi_active_notes.hpp"
+#include "mfmidi/midi_chase.hpp"
 #include "mfmidi/midi_device.hpp"
 #include "mfmidi/midi_events.hpp"
+#include "mfmidi/midi_port_router.hpp"
 #include "mfmidi/midi_tempo.hpp"
+#include "mfmidi/mpsc_queue.hpp"
+#include "mfmidi/playback_clock.hpp"
+#include "mfmidi/player_metrics.hpp"
 #include "mfmidi/smf/division.hpp"
+#include "mfmidi/smf/tempo_map.hpp"
 #include "mfmidi/timingapi.hpp"
 
+#include <algorithm>
 #include <atomic>
+#include <cmath>
 #include <cassert>
 #include <concepts>
-#include <condition_variable>
 #include <functional>
 #include <memory>
-#include <mutex>
 #include <optional>
 #include <ranges>
 #include <stdexcept>
 #include <stop_token>
+#include <unordered_map>
 #include <thread>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace mfmidi {
     using namespace std::literals;
 
     namespace details {
-        // template <class Track, class Time, playhead_status Status>
-        // struct basic_snapshot {
-        //     Time sleeptime{}; // time to next event
-        //     // playtime is key // current time
-        //     std::ranges::iterator_t<const Track> nextevent{}; // next event, if sleeptime==0, this is current event
-        //     Status                               status{};    // status of played events
-        // };
-        //
-        // template <class Track, class Time, class R, playhead_status Status, class StatusProc>
-        // inline Time buildPlaybackCache(const Track& trk, R& caches, Time cache_interval, MIDIDivision division, bool tempo_change_aware = true, MIDITempo default_tempo = 120_bpm)
-        // {
-        //     using Snapshot = basic_snapshot<Track, Time, Status>;
-        //
-        //     if (std::ranges::empty(trk)) {
-        //         return {};
-        //     }
-        //
-        //     Time   playtime{};
-        //     auto   nextevent = trk.begin();
-        //     Status status;
-        //     status.tempo = default_tempo;
-        //     StatusProc status_proc(status);
-        //     Time       divns         = divisionToDuration(division, status.tempo);
-        //     Time       nextCacheTime = cache_interval;
-        //     Snapshot   snap{};
-        //
-        //     while (true) {
-        //         while (playtime + (*nextevent).delta_time() * divns < nextCacheTime) { // use < because ignore the event on nextCacheTime (the event will play when tick, but have not played yet when cache)
-        //             playtime += (*nextevent).delta_time() * divns;
-        //             status_proc.process(*nextevent);
-        //             if (tempo_change_aware && midi_message_owning_view{*nextevent}.is_tempo()) {
-        //                 divns = divisionToDuration(division, status.tempo);
-        //             }
-        //             ++nextevent;
-        //             if (nextevent == trk.end()) {
-        //                 return playtime; // see directGoTo
-        //             }
-        //         }
-        //         snap.nextevent        = nextevent;
-        //         snap.sleeptime        = playtime + nextevent->delta_time() * divns - nextCacheTime; // see directGoTo
-        //         snap.status           = status;
-        //         caches[nextCacheTime] = std::move(snap);
-        //         nextCacheTime += cache_interval;
-        //     }
-        // }
+        /// \brief Messages of one time point, sent with a single send_batch per device
+        class output_batch {
+        public:
+            /// \brief Note ons which are dropped, with their note offs
+            struct note_budget {
+                uint8_t min_velocity;  ///< softer note ons are dropped
+                size_t  max_polyphony; ///< note ons over this many sounding notes of a device are dropped
+            };
+
+        private:
+            struct entry {
+                midi_device* device;
+                size_t       begin; // in _bytes
+                size_t       end;
+                bool         done;
+            };
+
+            struct device_notes {
+                midi_device*    device;
+                active_note_map sounding;
+                active_note_map dropped; // note ons dropped, their note offs are dropped too
+            };
+
+            std::vector<uint8_t>     _bytes;
+            std::vector<entry>       _entries;
+            std::vector<message_ref> _refs;
+            bool                     _keep_deviceless = false;
+
+            std::vector<device_notes> _notes;
+            size_t                    _last_notes = 0;
+
+            std::optional<note_budget> _budget;
+            size_t                     _dropped_notes = 0; // bits set in dropped maps
+            std::atomic<uint64_t>      _skipped{0};
+
+        public:
+            void add(midi_device* device, std::span<const uint8_t> msg)
+            {
+                if (device == nullptr) {
+                    if (!_keep_deviceless) {
+                        return;
+                    }
+                } else {
+                    device_notes& notes = notes_of(device);
+                    if ((_budget || _dropped_notes != 0) && drop(notes, msg)) {
+                        _skipped.fetch_add(1, std::memory_order_relaxed);
+                        return;
+                    }
+                    notes.sounding.process(msg);
+                }
+                const size_t begin = _bytes.size();
+                _bytes.insert(_bytes.end(), msg.begin(), msg.end());
+                _entries.push_back({device, begin, _bytes.size(), false});
+            }
+
+            [[nodiscard]] bool empty() const noexcept
+            {
+                return _entries.empty();
+            }
+
+            [[nodiscard]] size_t size() const noexcept
+            {
+                return _entries.size();
+            }
+
+            /// \brief Also collect messages of playheads without a device
+            void set_keep_deviceless(bool keep) noexcept
+            {
+                _keep_deviceless = keep;
+            }
+
+            /// \brief Send everything, messages of a device keep their order
+            void flush()
+            {
+                flush([](midi_device* device, std::span<const message_ref> msgs) {
+                    if (device != nullptr) {
+                        device->send_batch(msgs);
+                    }
+                });
+            }
+
+            /// \brief Call \a visitor(device, msgs) once per device, then clear
+            template <std::invocable<midi_device*, std::span<const message_ref>> Visitor>
+            void flush(Visitor&& visitor)
+            {
+                for (size_t first = 0; first < _entries.size(); ++first) {
+                    if (_entries[first].done) {
+                        continue;
+                    }
+                    midi_device* device = _entries[first].device;
+                    _refs.clear();
+                    for (size_t index = first; index < _entries.size(); ++index) {
+                        entry& msg = _entries[index];
+                        if (!msg.done && msg.device == device) {
+                            _refs.emplace_back(_bytes.data() + msg.begin, msg.end - msg.begin);
+                            msg.done = true;
+                        }
+                    }
+                    visitor(device, std::span<const message_ref>{_refs});
+                }
+                _bytes.clear();
+                _entries.clear();
+            }
+
+            /// \brief Send note offs of sounding notes, one send_batch per device
+            void release_notes()
+            {
+                for (auto& notes : _notes) {
+                    notes.sounding.release(*notes.device);
+                    notes.dropped.clear();
+                }
+                _dropped_notes = 0;
+            }
+
+            /// \brief Add a note off for every sounding note, sent by the next flush
+            void add_note_offs()
+            {
+                for (size_t index = 0; index < _notes.size(); ++index) {
+                    _notes[index].dropped.clear();
+                    const active_note_map sounding = _notes[index].sounding; // add() updates it
+                    sounding.emit([&](std::span<const uint8_t> msg) { add(_notes[index].device, msg); });
+                }
+                _dropped_notes = 0;
+            }
+
+            /// \brief Drop note ons over \a budget from now, std::nullopt to stop
+            void set_note_budget(std::optional<note_budget> budget) noexcept
+            {
+                _budget = budget;
+            }
+
+            /// \brief Count of messages dropped by the note budget, thread safe
+            [[nodiscard]] uint64_t skipped() const noexcept
+            {
+                return _skipped.load(std::memory_order_relaxed);
+            }
+
+            void reset_skipped() noexcept
+            {
+                _skipped.store(0, std::memory_order_relaxed);
+            }
+
+        private:
+            device_notes& notes_of(midi_device* device)
+            {
+                if (_last_notes < _notes.size() && _notes[_last_notes].device == device) {
+                    return _notes[_last_notes];
+                }
+                auto found  = std::ranges::find(_notes, device, &device_notes::device);
+                _last_notes = found - _notes.begin();
+                if (found == _notes.end()) {
+                    _notes.push_back({device, {}, {}});
+                }
+                return _notes[_last_notes];
+            }
+
+            /// \return \a msg is a note on over the budget, or the note off of a dropped one
+            bool drop(device_notes& notes, std::span<const uint8_t> msg) noexcept
+            {
+                if (msg.size() < 3) {
+                    return false;
+                }
+                const uint8_t kind    = msg[0] & 0xF0U;
+                const uint8_t channel = msg[0] & 0x0FU;
+                const uint8_t note    = msg[1] & 0x7FU;
+                if (kind == MIDIMsgStatus::NOTE_ON && msg[2] != 0) {
+                    // a retriggered note keeps its note on, its note off would end both
+                    const bool drop_on = _budget && !notes.sounding.test(channel, note) && (msg[2] < _budget->min_velocity || notes.sounding.count() >= _budget->max_polyphony);
+                    if (drop_on != notes.dropped.test(channel, note)) {
+                        notes.dropped.set(channel, note, drop_on);
+                        drop_on ? ++_dropped_notes : --_dropped_notes;
+                    }
+                    return drop_on;
+                }
+                if ((kind == MIDIMsgStatus::NOTE_OFF || kind == MIDIMsgStatus::NOTE_ON) && notes.dropped.test(channel, note)) {
+                    notes.dropped.set(channel, note, false);
+                    --_dropped_notes;
+                    return true;
+                }
+                return false;
+            }
+        };
+
+        /// \brief Playback position of a playhead, restorable without replaying events
+        template <class Track, class Time>
+        struct basic_snapshot {
+            std::ranges::iterator_t<const Track> nextmsg{};   // next event
+            uint64_t                             tick{};      // absolute tick of nextmsg
+            Time                                 playtime{};  // current time
+            Time                                 sleeptime{}; // time to nextmsg
+            tempo                                tempo = 120_bpm;
+            uint64_t                             anchor_tick{};
+            Time                                 anchor_time{};
+            uint16_t                             port = no_output_port; // set by events before nextmsg
+        };
 
         struct emulated_message_t {};
         struct realtime_message_t {};
@@ -96,6 +255,16 @@ namespace mfmidi {
         inline constexpr auto realtime_message        = realtime_message_t{};
         inline constexpr auto emulated_rewind_message = emulated_rewind_message_t{};
 
+        template <class Handler, bool TempoChangedAware>
+        struct handler_event_token {
+            using type = char;
+        };
+
+        template <class Handler>
+        struct handler_event_token<Handler, true> {
+            using type = std::optional<decltype(std::declval<Handler&>().add_event_handler([](auto&&...) {}))>;
+        };
+
         /// \brief Internal class for holding status and play status
         ///
         template <std::ranges::forward_range Track, class Handler = void>
@@ -103,42 +272,63 @@ namespace mfmidi {
         class track_playhead {
         public:
             using Time                                = std::chrono::nanoseconds; // must be signed
+            using snapshot                            = basic_snapshot<Track, Time>;
             static constexpr bool tempo_changed_aware = !std::is_void_v<Handler> && event_emitter_of<Handler, events::tempo_changed>;
 
         private:
             static constexpr bool have_handler = !std::is_void_v<Handler>;
-            // Information
-            std::string _name;
-
-            // Playing status
-            Time  _divns{}; // 1 delta-time in nanoseconds
-            Time  _divns_old{};
-            Time  _sleeptime{}; // sleep period before mnextevent ticks
-            Time  _playtime{};  // current time, support 5850 centuries long
-            Time  _compensation{};
-            tempo _tempo = 120_bpm;
-
-            // Data
-            midi_device* _dev{};
 
+            // Hot: read by every tick, kept together at the front
+            Time                                 _sleeptime{}; // sleep period before mnextevent ticks
+            Time                                 _playtime{};  // current time, support 5850 centuries long
             const Track*                         _track{};
             std::ranges::iterator_t<const Track> _nextmsg{};
+            uint64_t                             _tick{};      // absolute tick of _nextmsg
+            output_batch*                        _output{};    // collects sent messages instead of _dev if set
+            midi_device*                         _dev{};
+            const port_router*                   _router{};
+            uint16_t                             _port = no_output_port;
+
+            std::conditional_t<have_handler, std::reference_wrapper<Handler>, char> _handler{};
 
+            tempo    _tempo_old{}; // tempo before a change not applied yet
             division _division{};
 
-            std::reference_wrapper<Handler>                                                                                                     _handler{};
-            std::conditional_t<tempo_changed_aware, std::optional<decltype(std::declval<Handler>().add_event_handler([](auto&&...) {}))>, char> _handler_event_token;
+            // Warm: read when an event is reached
+            tempo _tempo = 120_bpm;
+
+            // Without a tempo map, tick times are computed exactly from the last tempo change
+            uint64_t _anchor_tick{};
+            Time     _anchor_time{};
+
+            // Tempo map, replaces the anchor if set
+            const mfmidi::tempo_map*  _tempo_map{};
+            mfmidi::tempo_map::cursor _tempo_cursor;
+
+            // Cold
+            Time        _compensation{};
+            std::string _name;
+
+            typename handler_event_token<Handler, tempo_changed_aware>::type _handler_event_token;
 
         public:
-            explicit track_playhead(std::string_view name, Handler& handler) noexcept
-                : _name(name)
-                , _handler(handler)
+            template <class H = Handler>
+                requires(!std::is_void_v<H>)
+            explicit track_playhead(std::string_view name, std::type_identity_t<H>& handler) noexcept
+                : _handler(handler)
+                , _name(name)
             {
                 if constexpr (tempo_changed_aware) {
                     register_handler(*this);
                 }
             }
 
+            explicit track_playhead(std::string_view name) noexcept
+                requires(!have_handler)
+                : _name(name)
+            {
+            }
+
             ~track_playhead() noexcept
             {
                 if constexpr (tempo_changed_aware) {
@@ -153,23 +343,25 @@ namespace mfmidi {
             track_playhead& operator=(track_playhead&&) noexcept = delete;
             // re-register should be done for moving
 
+            /// \brief Apply a tempo change: rescale the rest of the sleep and restart timing from the next event
             void retiming() noexcept
             {
-                if (_divns_old == 0ns) {
-                    _divns_old = _divns;
+                if (_division.is_ppq() && _tempo_old) {
+                    const auto rest = static_cast<uint64_t>(_sleeptime.count()); // a long sleep times mspq overflows
+                    _sleeptime      = Time{static_cast<Time::rep>(details::mul_div(rest, _tempo.mspq(), _tempo_old.mspq()))};
                 }
-                auto newdivns = division_to_duration(_division, _tempo);
-                // if ((_sleeptime.count() != 0) || (_divns.count() != 0)) {
-                //     _sleeptime = Time{_sleeptime.count() * newdivns.count() / _divns.count()};
-                // }
-                _divns = newdivns;
+                _anchor_tick = _tick;
+                _anchor_time = _playtime + _sleeptime;
+                _tempo_old   = {};
             }
 
             Time tick(Time slept /*the time that slept*/)
             {
                 if (eof()) {
+                    _playtime += slept; // time goes on after the last event
                     return Time::max();
                 }
+                [[maybe_unused]] bool retimed = false;
             TICK_BEGIN:
                 _playtime += slept; // not move it to playthread because of lastSleptTime = 0 in revertSnapshot
 
@@ -180,24 +372,34 @@ namespace mfmidi {
                 //     slept = _sleeptime;
                 // }
                 _sleeptime -= slept;
-                if (_divns_old != 0ns) {
-                    _sleeptime = _sleeptime * _divns.count() / _divns_old.count();
-                    _divns_old = 0ns;
+                if (_tempo_old) { // changed by another playhead
+                    retiming();
                 }
                 if (_sleeptime != 0ns) {
                     return _sleeptime;
                 }
                 if constexpr (have_handler) {
                     _handler(realtime_message, msg);
+                    if (_tempo_old) { // changed by this event
+                        retiming();
+                        retimed = true;
+                    }
+                }
+                if (msg.is_output_port()) {
+                    _port = msg.output_port();
                 }
-                if (_dev != nullptr) {
-                    _dev->send_msg(msg);
+                midi_device* dev = _router != nullptr ? _router->device(_port, msg, _dev) : _dev;
+                if (_output != nullptr) {
+                    _output->add(dev, msg);
+                } else if (dev != nullptr) {
+                    dev->send_msg(msg);
                 }
                 ++_nextmsg;
                 if (eof()) {
                     return Time::max();
                 }
-                _sleeptime = (*_nextmsg).delta_time() * _divns;
+                _tick += (*_nextmsg).delta_time();
+                _sleeptime = step_duration();
 
                 // if (_sleeptime <= _compensation) {
                 //     _compensation -= _sleeptime;
@@ -209,7 +411,7 @@ namespace mfmidi {
                     goto TICK_BEGIN;
                 }
                 if constexpr (have_handler) {
-                    if (_divns_old != 0ns) {
+                    if (retimed) {
                         return 0ns; //! signal all playheads to tick
                     }
                 }
@@ -237,8 +439,12 @@ namespace mfmidi {
             {
                 assert(_playtime <= target);
                 if (eof()) {
+                    _playtime = target;
                     return false;
                 }
+                if (_tempo_old) {
+                    retiming();
+                }
                 while (true) {
                     auto&& msg = *_nextmsg;
                     if (_playtime + _sleeptime >= target) { // time point before it happen
@@ -247,37 +453,51 @@ namespace mfmidi {
                         return true;
                     }
                     _playtime += _sleeptime;
+                    _sleeptime = 0ns;
                     if constexpr (have_handler) {
                         _handler(emulated_message, msg);
+                        if (_tempo_old) {
+                            retiming();
+                        }
+                    }
+                    if (msg.is_output_port()) {
+                        _port = msg.output_port();
                     }
                     ++_nextmsg;
                     if (eof()) {
                         _sleeptime = 0ns; // optional
+                        _playtime  = target;
                         return false;
                     }
-                    _sleeptime = (*_nextmsg).delta_time() * _divns;
+                    _tick += (*_nextmsg).delta_time();
+                    _sleeptime = step_duration();
                 }
             }
 
             // actually negative playtime should be okay
             void go_rewind(Time target)
-                // requires std::ranges::bidirectional_range<Track>
-                requires(!have_handler) // i have no idea about how to implement that with a handler
+                requires(!have_handler && std::ranges::bidirectional_range<Track>) // i have no idea about how to implement that with a handler
             {
                 assert(_playtime >= target);
-                const auto& begin = std::ranges::cbegin(_track);
+                const auto begin       = std::ranges::begin(*_track);
+                bool       port_passed = false; // an output port event is not played anymore
                 if (eof()) {
+                    const Time last_event = _tempo_map != nullptr ? _tempo_cursor.tick_to_time(_tick) : anchored_time(_tick);
+                    if (target > last_event) {
+                        _playtime = target; // still after the last event
+                        return;
+                    }
                     // rewind to the time point before the last event happens
                     --_nextmsg;
-                    _sleeptime = 0ns;
+                    _sleeptime  = last_event - _playtime; // playtime went on after it
+                    port_passed = (*_nextmsg).is_output_port();
                 }
                 while (true) {
-                    auto&& event = _nextmsg;
-                    auto   last  = _playtime - (event.delta_time() - _sleeptime);
+                    auto last = _playtime - (step_duration() - _sleeptime);
                     if (last <= target) {
                         _sleeptime = _playtime + _sleeptime - target;
                         _playtime  = target;
-                        return;
+                        break;
                     }
                     _playtime  = last;
                     _sleeptime = 0ns;
@@ -285,19 +505,139 @@ namespace mfmidi {
                         assert(target <= 0ns);
                         _sleeptime = -target;
                         _playtime  = target;
-                        return;
+                        break;
                     }
+                    _tick -= (*_nextmsg).delta_time();
                     --_nextmsg;
+                    port_passed = port_passed || (*_nextmsg).is_output_port();
+                }
+                if (port_passed) {
+                    _port = no_output_port;
+                    for (auto it = _nextmsg; it != begin;) {
+                        if ((*--it).is_output_port()) {
+                            _port = (*it).output_port();
+                            break;
+                        }
+                    }
+                }
+            }
+
+            [[nodiscard]] snapshot save_snapshot() const
+            {
+                return {_nextmsg, _tick, _playtime, _sleeptime, _tempo, _anchor_tick, _anchor_time, _port};
+            }
+
+            /// \brief Jump to \a snap, events between are not passed to the handler
+            void restore_snapshot(const snapshot& snap)
+            {
+                _nextmsg     = snap.nextmsg;
+                _tick        = snap.tick;
+                _playtime    = snap.playtime;
+                _sleeptime   = snap.sleeptime;
+                _tempo       = snap.tempo;
+                _tempo_old   = {};
+                _anchor_tick = snap.anchor_tick;
+                _anchor_time = snap.anchor_time;
+                _port        = snap.port;
+            }
+
+            /// \brief Snapshots of a playhead playing \a track every \a interval
+            ///
+            /// Timing only depends on \a map, or on the default tempo without a map,
+            /// so this can run on any thread. A snapshot is only taken when an event
+            /// passed since the previous one, restoring it then seeking to a later
+            /// checkpoint replays nothing.
+            ///
+            /// \return Sorted by playtime, empty if stopped
+            [[nodiscard]] static std::vector<snapshot> build_snapshots(const Track& track, mfmidi::division division, const mfmidi::tempo_map* map, Time interval, const std::stop_token& stop = {})
+            {
+                if (interval <= 0ns) {
+                    throw std::invalid_argument{"build_snapshots: interval must be positive"};
+                }
+                std::vector<snapshot>     result;
+                mfmidi::tempo_map::cursor cursor;
+                if (map != nullptr) {
+                    cursor = map->make_cursor();
+                }
+                uint64_t tick       = 0;
+                uint16_t port       = no_output_port;
+                Time     checkpoint = interval;
+                auto     end        = std::ranges::end(track);
+                for (auto it = std::ranges::begin(track); it != end; ++it) {
+                    if (stop.stop_requested()) {
+                        return {};
+                    }
+                    tick += (*it).delta_time();
+                    const Time time = map != nullptr ? cursor.tick_to_time(tick) : ticks_to_duration(division, 120_bpm, tick);
+                    if (time >= checkpoint) {
+                        // checkpoints up to the event would all restore to it, only keep the first
+                        result.push_back({.nextmsg = it, .tick = tick, .playtime = checkpoint, .sleeptime = time - checkpoint, .port = port});
+                        checkpoint = time - ((time - checkpoint) % interval) + interval;
+                    }
+                    if ((*it).is_output_port()) {
+                        port = (*it).output_port();
+                    }
+                }
+                return result;
+            }
+
+            /// \brief Snapshot at \a target with the current timing, the playhead is not moved
+            ///
+            /// Scans the track from the beginning without calling the handler.
+            ///
+            /// \throw std::logic_error Timing depends on tempo changes emitted by the handler, set a tempo map
+            [[nodiscard]] snapshot snapshot_at(Time target) const
+            {
+                if (tempo_changed_aware && _tempo_map == nullptr) {
+                    throw std::logic_error{"snapshot_at: a tempo map is required when the handler changes tempo"};
+                }
+                assert(_track != nullptr);
+                return snapshot_at(*_track, _division, _tempo_map, save_snapshot(), target);
+            }
+
+            /// \brief Snapshot at \a target of a playhead playing \a track
+            ///
+            /// Timed by \a map, or by the tempo and anchor of \a timing without a map, such
+            /// as a save_snapshot() of the playhead. Only reads its arguments, so this can
+            /// run on any thread.
+            [[nodiscard]] static snapshot snapshot_at(const Track& track, mfmidi::division division, const mfmidi::tempo_map* map, const snapshot& timing, Time target)
+            {
+                mfmidi::tempo_map::cursor cursor;
+                if (map != nullptr) {
+                    cursor = map->make_cursor();
                 }
+                uint64_t tick = 0;
+                uint16_t port = no_output_port;
+                auto     it   = std::ranges::begin(track);
+                for (const auto end = std::ranges::end(track); it != end; ++it) {
+                    tick += (*it).delta_time();
+                    const Time time = map != nullptr ? cursor.tick_to_time(tick) : anchored_time(division, timing.tempo, timing.anchor_tick, timing.anchor_time, tick);
+                    if (time >= target) {
+                        return {it, tick, target, time - target, timing.tempo, timing.anchor_tick, timing.anchor_time, port};
+                    }
+                    if ((*it).is_output_port()) {
+                        port = (*it).output_port();
+                    }
+                }
+                return {it, tick, target, 0ns, timing.tempo, timing.anchor_tick, timing.anchor_time, port}; // finished
             }
 
             [[nodiscard]] division     division() const { return _division; }
             [[nodiscard]] tempo        tempo() const { return _tempo; }
             [[nodiscard]] midi_device* device() const { return _dev; }
+            [[nodiscard]] const port_router* router() const { return _router; }
+            [[nodiscard]] uint16_t     output_port() const { return _port; } ///< no_output_port before an Output Port event
             [[nodiscard]] const Track* track() const { return _track; }
             [[nodiscard]] bool         eof() const { return _nextmsg == _track->end(); }
-            [[nodiscard]] Handler&     handler() const { return _handler.get(); }
+            [[nodiscard]] auto&        handler() const
+                requires have_handler
+            {
+                return _handler.get();
+            }
             [[nodiscard]] Time         playtime() const { return _playtime; }
+            [[nodiscard]] Time         sleeptime() const { return _sleeptime; }
+            [[nodiscard]] uint64_t     next_event_tick() const { return _tick; }
+            [[nodiscard]] const mfmidi::tempo_map* tempo_map() const { return _tempo_map; }
 
             void set_division(mfmidi::division div)
             {
@@ -306,10 +646,22 @@ namespace mfmidi {
                 reset_playhead_to_begin();
             }
 
+            /// \brief Change tempo from the current position, applied on next tick
             void set_tempo(mfmidi::tempo tempo)
             {
+                if (_tempo_map == nullptr && !_tempo_old) {
+                    _tempo_old = _tempo;
+                }
                 _tempo = tempo;
-                retiming();
+            }
+
+            /// \brief Time events with \a map instead of tempo changes, nullptr to disable
+            void set_tempo_map(const mfmidi::tempo_map* map)
+            {
+                _tempo_map = map;
+                if (_track != nullptr) {
+                    reset_playhead_to_begin();
+                }
             }
 
             void set_device(midi_device* dev)
@@ -317,13 +669,27 @@ namespace mfmidi {
                 _dev = dev;
             }
 
+            /// \brief Route messages by the output port of the track, nullptr to always use device()
+            void set_router(const port_router* router) noexcept
+            {
+                _router = router;
+            }
+
+            /// \brief Collect messages into \a output instead of sending them, nullptr to send at once
+            void set_output_batch(output_batch* output) noexcept
+            {
+                _output = output;
+            }
+
             void set_track(const Track* track)
             {
                 _track = track;
                 reset_playhead_to_begin();
             }
 
-            void set_handler(Handler& handler)
+            template <class H = Handler>
+                requires(!std::is_void_v<H>)
+            void set_handler(std::type_identity_t<H>& handler)
             {
                 _handler = handler;
             }
@@ -331,12 +697,43 @@ namespace mfmidi {
             void reset_playhead_to_begin()
             {
                 assert(_track != nullptr);
-                _nextmsg  = std::ranges::begin(*_track);
-                _playtime = 0ns;
-                _tempo    = 120_bpm;
-                _divns    = {};
-                retiming();
-                _sleeptime = (*_nextmsg).delta_time() * _divns;
+                _nextmsg     = std::ranges::begin(*_track);
+                _playtime    = 0ns;
+                _tempo       = 120_bpm;
+                _tempo_old   = {};
+                _anchor_tick = 0;
+                _anchor_time = 0ns;
+                _port        = no_output_port;
+                if (_tempo_map != nullptr) {
+                    _tempo_cursor = _tempo_map->make_cursor();
+                }
+                _tick      = (*_nextmsg).delta_time();
+                _sleeptime = step_duration();
+            }
+
+            /// \brief Time between the previous event and _nextmsg
+            Time step_duration()
+            {
+                const auto delta = (*_nextmsg).delta_time();
+                if (_tempo_map != nullptr) {
+                    const auto last = _tempo_cursor.tick_to_time(_tick - delta);
+                    return _tempo_cursor.tick_to_time(_tick) - last;
+                }
+                return anchored_time(_tick) - anchored_time(_tick - delta);
+            }
+
+            [[nodiscard]] Time anchored_time(uint64_t tick) const noexcept
+            {
+                return anchored_time(_division, _tempo, _anchor_tick, _anchor_time, tick);
+            }
+
+            /// \brief Time of \a tick when \a anchor_tick is at \a anchor_time and the tempo is \a tempo
+            [[nodiscard]] static Time anchored_time(mfmidi::division division, mfmidi::tempo tempo, uint64_t anchor_tick, Time anchor_time, uint64_t tick) noexcept
+            {
+                if (tick >= anchor_tick) {
+                    return anchor_time + ticks_to_duration(division, tempo, tick - anchor_tick);
+                }
+                return anchor_time - ticks_to_duration(division, tempo, anchor_tick - tick);
             }
 
         protected:
@@ -377,17 +774,48 @@ namespace mfmidi {
 
             using PlayheadRemovalHandler = std::function<void(playhead_info&&)>;
 
+            /// \brief Snapshots of the group every \a interval, see build_seek_cache
+            struct seek_cache {
+                struct entry {
+                    // playhead status when built, the entry is ignored if changed
+                    const Track*             track;
+                    mfmidi::division         division;
+                    const mfmidi::tempo_map* tempo_map;
+
+                    std::vector<typename Playhead::snapshot> snapshots;
+                };
+
+                Time                                       interval;
+                std::unordered_map<const Playhead*, entry> entries;
+            };
+
+            /// \brief Played again and again, in base time, see set_loop
+            struct loop_region {
+                Time start;
+                Time end; ///< events at the end are not played
+            };
+
+            /// \brief Which events to drop while the player thread is late, see set_overload_policy
+            struct overload_policy {
+                Time    threshold     = 20ms; ///< lateness of a wakeup which starts dropping, it stops below half of it
+                uint8_t min_velocity  = 32;   ///< softer note ons are dropped
+                size_t  max_polyphony = 64;   ///< note ons over this many sounding notes of a device are dropped
+            };
+
         private:
-            // RAII class for auto pause and play
+            // RAII class for auto pause and play, the player thread is parked meanwhile
             class Pauser {
             public:
                 explicit Pauser(track_playhead_group& seq)
                     : player(seq)
-                    , toplay(seq.pause())
-                {}
+                    , toplay(seq.suspend())
+                {
+                    player.park();
+                }
 
                 ~Pauser()
                 {
+                    player.unpark();
                     if (toplay) {
                         player.play();
                     }
@@ -403,19 +831,133 @@ namespace mfmidi {
                 bool                  toplay;
             };
 
+            // RAII class for reading playback data without pausing, the player thread is parked meanwhile
+            class Parker {
+            public:
+                explicit Parker(track_playhead_group& seq)
+                    : player(seq)
+                {
+                    player.park();
+                }
+
+                ~Parker()
+                {
+                    player.unpark();
+                }
+
+                Parker(const Parker&)            = delete;
+                Parker(Parker&&)                 = delete;
+                Parker& operator=(const Parker&) = delete;
+                Parker& operator=(Parker&&)      = delete;
+
+            private:
+                track_playhead_group& player;
+            };
+
+            // Tick bookkeeping of the group, contiguous and parallel to _playheads.
+            // Deadlines live in _schedule, the track cursor stays in the playhead.
+            struct hot_playhead {
+                Playhead* playhead;
+                Time      ticked; // group time of the last tick
+            };
+
             // Playback
-            std::vector<playhead_info> _playheads;
+            std::vector<playhead_info> _playheads; // cold side table, owns the playheads
+            std::vector<hot_playhead>  _hot;
             PlayheadRemovalHandler     _rhandler;
             // std::vector<std::chrono::nanoseconds> msleeptimecache; // use in playThread, cache sleep time of cursors
             Time _timeToSlept{}; // if you changed playback data, set this to 0 and it will be recalcuated
-            Time _compensation{};
+
+            // Clock
+            playback_clock* _clock = &monotonic_clock::instance();
+            Time            _anchor_now{};  // group time at _anchor_wall
+            Time            _anchor_wall{}; // clock time, deadlines are absolute from here
+
+            // Rate, applied between group time and clock time only
+            double              _rate = 1.0;
+            std::atomic<double> _requested_rate{1.0};
+
+            // Scheduler
+            struct schedule_entry {
+                Time   deadline; // group time
+                size_t index;    // in _playheads, breaks ties so playheads keep their order
+
+                auto operator<=>(const schedule_entry&) const = default;
+            };
+
+            details::output_batch       _output;            // messages of the current wakeup
+            std::vector<schedule_entry> _schedule;          // min-heap, only due playheads are ticked
+            Time                        _now{};             // group time of the last wakeup
+            bool                        _reschedule = true; // set it with _timeToSlept
 
             // Thread
             std::jthread            _thread;
-            bool                    _wakeup = false;
-            std::mutex              _mutex;
-            std::condition_variable _condvar;
-            std::atomic_flag        _play; // since C++20
+            player_thread_options   _thread_options;
+            std::atomic<int>        _thread_options_result{0};
+            std::atomic<uint32_t>   _signal{0}; // bumped to wake the player thread
+            std::atomic_flag        _play;      // since C++20
+            std::atomic<uint32_t>   _park_requests{0}; // Pausers and Parkers alive, the player thread does not touch playback data meanwhile
+            std::atomic<bool>       _parked{false};    // the player thread waits for _park_requests to drop to 0
+
+            // Commands, see post()
+            struct command {
+                std::function<void(track_playhead_group&)> action;
+                std::optional<Time>                        at; // base time
+            };
+
+            mpsc_queue<command>  _commands;
+            std::vector<command> _timed_commands; // sorted by at, player thread only
+            Time                 _command_latency = 10ms;
+
+            // Seek cache
+            std::atomic<std::shared_ptr<const seek_cache>> _seek_cache;
+            std::jthread                                   _seek_cache_thread;
+            std::atomic<bool>                              _chase_on_seek{true};
+
+            // Note release, on the player thread
+            std::atomic<bool> _release_notes{false};
+            std::atomic<bool> _release_notes_on_stop{true};
+
+            // Overload
+            std::optional<overload_policy> _overload_policy;
+            std::atomic<bool>              _overloaded{false};
+
+            player_metrics _metrics;
+
+            const port_router* _router{};
+
+            // Messages of one device, see chase_batches
+            struct chase_batch {
+                midi_device*             device;
+                std::vector<uint8_t>     bytes;
+                std::vector<message_ref> msgs; // into bytes
+            };
+
+            // A playhead to chase, see chase_batches
+            struct chase_source {
+                const Track*                track;
+                midi_device*                device;
+                typename Playhead::snapshot at;
+            };
+
+            // Loop, everything needed to jump back is prepared by set_loop
+            struct loop_state {
+                struct entry {
+                    // playhead status when set, the snapshot is not used if changed
+                    const Playhead*          playhead;
+                    const Track*             track;
+                    mfmidi::division         division;
+                    const mfmidi::tempo_map* tempo_map;
+
+                    typename Playhead::snapshot start;
+                };
+
+                loop_region              region;
+                std::vector<entry>       entries; // parallel to _playheads
+                std::vector<chase_batch> chase;
+            };
+
+            std::optional<loop_state> _loop;
 
         public:
             track_playhead_group() noexcept = default;
@@ -423,10 +965,9 @@ namespace mfmidi {
             ~track_playhead_group() noexcept
             {
                 _thread.request_stop();
-                {
-                    std::lock_guard<std::mutex> guard{_mutex};
-                    _wakeup = true;
-                    _condvar.notify_all();
+                wake();
+                if (_thread.joinable()) {
+                    _thread.join(); // before the members it uses are destroyed
                 }
             }
 
@@ -447,20 +988,52 @@ namespace mfmidi {
 
             [[nodiscard]] PlayheadRemovalHandler playhead_removal_handler() const { return _rhandler; }
 
+            [[nodiscard]] playback_clock& clock() const noexcept { return *_clock; }
+
+            /// \brief Wait on \a clock instead of the monotonic clock, it must outlive the group
+            void set_clock(playback_clock& clock)
+            {
+                Pauser pauser{*this};
+                _clock       = &clock;
+                _timeToSlept = 0ns;
+                _reschedule  = true;
+            }
+
+            /// \brief Call \a handler on the player thread with each finished playhead
+            ///
+            /// Setters of the group wait for the player thread, so they must not be called
+            /// while holding a lock that \a handler takes: move the playheads out under the
+            /// lock and add them back after releasing it.
             void set_playhead_removal_handler(PlayheadRemovalHandler handler)
             {
+                Pauser pauser{*this};
                 _rhandler = std::move(handler);
             }
 
             void set_division(division division)
             {
+                Pauser pauser{*this};
+                restart_timing();
                 for (auto& info : _playheads) {
                     info.playhead->set_division(division);
                 }
             }
 
-            void set_handler(Handler& handler)
+            /// \brief Time every playhead with \a map, which must outlive the group
+            void set_tempo_map(const mfmidi::tempo_map* map)
+            {
+                Pauser pauser{*this};
+                restart_timing();
+                for (auto& info : _playheads) {
+                    info.playhead->set_tempo_map(map);
+                }
+            }
+
+            template <class H = Handler>
+                requires(!std::is_void_v<H>)
+            void set_handler(std::type_identity_t<H>& handler)
             {
+                Pauser pauser{*this};
                 for (auto& info : _playheads) {
                     info.playhead->set_handler(handler);
                 }
@@ -471,8 +1044,8 @@ namespace mfmidi {
                 if (_playheads.empty()) {
                     throw std::out_of_range{"No playheads in group"};
                 }
-                const playhead_info& info = _playheads.front();
-                return info.playhead->playtime() - info.offest;
+                const hot_playhead& hot = _hot.front();
+                return hot.playhead->playtime() + (_now - hot.ticked) - _playheads.front().offest;
             }
 
             bool play()
@@ -484,38 +1057,44 @@ namespace mfmidi {
                     init_thread();
                 }
                 _play.test_and_set();
-                {
-                    std::lock_guard<std::mutex> guard{_mutex};
-                    _wakeup = true;
-                    _condvar.notify_all();
-                }
+                wake();
                 return true;
             }
 
             /// \return Return if the player is playing before pause
             bool pause()
             {
-                bool play = _play.test();
-                _play.clear();
+                bool play = suspend();
+                if (play && _release_notes_on_stop) {
+                    release_notes();
+                }
                 return play;
             }
 
             void set_track(const Track* data)
             {
                 Pauser pauser{*this};
-                _timeToSlept = 0ns;
+                restart_timing();
                 for (auto& info : _playheads) {
                     info.playhead->set_track(data);
                 }
             }
 
+            /// \brief Parks the player thread, never call it holding a lock the removal handler takes
             Playhead* add_playhead(std::unique_ptr<Playhead>&& playhead, Time setoffest = {})
             {
-                auto result = playhead.get();
+                Pauser pauser{*this};
+                auto   result = playhead.get();
+                result->set_output_batch(&_output);
+                result->set_router(_router);
                 _playheads.emplace_back(std::move(playhead), setoffest);
+                _hot.push_back({result, _now});
+                _timeToSlept = 0ns;
+                _reschedule  = true;
                 return result;
             }
 
+            /// \brief Playheads can be changed but not replaced, erased or reordered
             [[nodiscard]] auto playheads() noexcept
             {
                 return std::ranges::ref_view<decltype(_playheads)>{_playheads};
@@ -529,31 +1108,669 @@ namespace mfmidi {
                 }
             }
 
-            void seek(Time targetTime)
+            [[nodiscard]] const port_router* router() const noexcept { return _router; }
+
+            /// \brief Route messages of every playhead by the output port of its track
+            ///
+            /// Devices of the playheads stay the fallback of unrouted ports and of tracks
+            /// without an Output Port event. \a router must outlive its use, nullptr to stop routing.
+            /// A router with buffered routes must not be shared with another group.
+            void set_router(const port_router* router)
             {
                 Pauser pauser{*this};
-                _timeToSlept = {};
-                bool flag    = false;
-                for (auto& info : _playheads) {
-                    if (info.playhead->seek(targetTime + info.offest)) {
-                        flag = true;
-                    }
-                }
-                if (!flag) {
-                    throw std::out_of_range("targetTime out of range");
+                _router = router;
+                for (auto& cinfo : _playheads) {
+                    cinfo.playhead->set_router(router);
                 }
             }
 
-            void init_thread()
+            /// \brief Build snapshots every \a interval in background, used by seek() when done
+            ///
+            /// Changing tracks, division or tempo map of a playhead afterwards invalidates
+            /// its snapshots, as does changing the tempo of a playhead without a tempo map.
+            /// Events skipped by a snapshot are not passed to the handler.
+            ///
+            /// \throw std::logic_error Timing of a playhead depends on tempo changes emitted by the handler, set a tempo map
+            void build_seek_cache(Time interval = 1s)
             {
-                if (!_thread.joinable()) {
-                    _thread = std::jthread([this](const std::stop_token& stop) {
-                        playThread(stop);
-                    });
+                if (interval <= 0ns) {
+                    throw std::invalid_argument{"build_seek_cache: interval must be positive"};
+                }
+                Pauser                                                              pauser{*this};
+                std::vector<std::pair<const Playhead*, typename seek_cache::entry>> sources;
+                sources.reserve(_playheads.size());
+                for (auto& info : _playheads) {
+                    const Playhead& playhead = *info.playhead;
+                    if (playhead.track() == nullptr) {
+                        continue;
+                    }
+                    if (Playhead::tempo_changed_aware && playhead.tempo_map() == nullptr) {
+                        throw std::logic_error{"build_seek_cache: a tempo map is required when the handler changes tempo"};
+                    }
+                    sources.push_back({&playhead, {playhead.track(), playhead.division(), playhead.tempo_map(), {}}});
                 }
+
+                _seek_cache_thread = std::jthread{[this, interval, sources = std::move(sources)](const std::stop_token& stop) mutable {
+                    auto cache      = std::make_shared<seek_cache>();
+                    cache->interval = interval;
+                    for (auto& [playhead, entry] : sources) {
+                        entry.snapshots = Playhead::build_snapshots(*entry.track, entry.division, entry.tempo_map, interval, stop);
+                        if (stop.stop_requested()) {
+                            return;
+                        }
+                        cache->entries.emplace(playhead, std::move(entry));
+                    }
+                    _seek_cache.store(std::move(cache));
+                }};
             }
 
+            /// \brief Stop building and drop the seek cache
+            void clear_seek_cache()
+            {
+                _seek_cache_thread = {};
+                _seek_cache.store(nullptr);
+            }
+
+            [[nodiscard]] std::shared_ptr<const seek_cache> get_seek_cache() const
+            {
+                return _seek_cache.load();
+            }
+
+            void seek(Time targetTime)
+            {
+                Pauser pauser{*this};
+                restart_timing();
+                bool flag  = false;
+                auto cache = _seek_cache.load();
+                for (auto& info : _playheads) {
+                    if (cache) {
+                        jump_to_snapshot(*cache, *info.playhead, targetTime + info.offest);
+                    }
+                    if (info.playhead->seek(targetTime + info.offest)) {
+                        flag = true;
+                    }
+                }
+                if (!flag) {
+                    throw std::out_of_range("targetTime out of range");
+                }
+                if (_release_notes_on_stop) {
+                    _output.release_notes(); // the player thread is parked, released before the chase state
+                }
+                if (_chase_on_seek) {
+                    chase();
+                }
+            }
+
+            /// \brief Send program, controller, RPN/NRPN, pressure and bend state at the current position to every device
+            ///
+            /// Tracks are scanned from the beginning without calling the handler. Messages are
+            /// sent from the calling thread while the player thread is parked, so devices
+            /// never have two senders at a time.
+            void chase()
+            {
+                Pauser                    pauser{*this};
+                std::vector<chase_source> sources;
+                for (const auto& info : _playheads) {
+                    if (info.playhead->track() != nullptr) {
+                        sources.push_back({info.playhead->track(), info.playhead->device(), info.playhead->save_snapshot()});
+                    }
+                }
+                for (const auto& batch : chase_batches(sources, _router)) {
+                    batch.device->send_batch(batch.msgs);
+                }
+            }
+
+            [[nodiscard]] bool chase_on_seek() const noexcept { return _chase_on_seek.load(std::memory_order_relaxed); }
+
+            /// \brief Whether seek() calls chase(), default true
+            void set_chase_on_seek(bool enable) noexcept
+            {
+                _chase_on_seek.store(enable, std::memory_order_relaxed);
+            }
+
+            /// \brief Send a note off for every note the group left on, as one batch per device
+            ///
+            /// Done by the player thread at its next wakeup, before any later event.
+            /// Devices must stay alive until then. Thread safe.
+            void release_notes()
+            {
+                _release_notes.store(true, std::memory_order_release);
+                wake();
+            }
+
+            [[nodiscard]] bool release_notes_on_stop() const noexcept { return _release_notes_on_stop.load(std::memory_order_relaxed); }
+
+            /// \brief Whether pause(), seeking and reaching the end call release_notes(), default true
+            void set_release_notes_on_stop(bool enable) noexcept
+            {
+                _release_notes_on_stop.store(enable, std::memory_order_relaxed);
+            }
+
+            /// \brief Jump back to \a start whenever base time reaches \a end
+            ///
+            /// Positions and chase state at \a start are computed here once, on the calling
+            /// thread while playback goes on, so the player thread jumps back in
+            /// O(playheads) without a gap. Sounding notes are released at the jump and the
+            /// chase state is sent if chase_on_seek(). Playheads which reach the end of
+            /// their track are kept until clear_loop(). Changing tracks, division, tempo
+            /// map or tempo of a playhead afterwards makes it seek instead.
+            ///
+            /// \throw std::invalid_argument \a end is not after \a start
+            /// \throw std::logic_error Timing of a playhead depends on tempo changes emitted by the handler, set a tempo map
+            void set_loop(Time start, Time end)
+            {
+                if (end <= start) {
+                    throw std::invalid_argument{"set_loop: end must be after start"};
+                }
+                loop_state loop = make_loop(start, end);
+                Parker     parker{*this};
+                _loop        = std::move(loop); // moving keeps msgs pointing into bytes
+                _timeToSlept = 0ns;
+            }
+
+            /// \brief Loop between ticks of the first playhead
+            /// \throw std::logic_error The first playhead has no tempo map
+            void set_loop_ticks(uint64_t start, uint64_t end)
+            {
+                Pauser pauser{*this}; // the first playhead is read, set_loop parks again
+                if (_playheads.empty() || _playheads.front().playhead->tempo_map() == nullptr) {
+                    throw std::logic_error{"set_loop_ticks: the first playhead needs a tempo map"};
+                }
+                const playhead_info& info = _playheads.front();
+                const auto*          map  = info.playhead->tempo_map();
+                set_loop(map->tick_to_time(start) - info.offest, map->tick_to_time(end) - info.offest);
+            }
+
+            /// \brief Stop looping, playheads at the end of their track are removed
+            void clear_loop()
+            {
+                Pauser pauser{*this};
+                _loop.reset();
+                remove_finished();
+                _timeToSlept = 0ns;
+            }
+
+            [[nodiscard]] std::optional<loop_region> loop() const
+            {
+                return _loop ? std::optional{_loop->region} : std::nullopt;
+            }
+
+            /// \brief Change tempo of playheads which are not timed by a tempo map
+            void set_tempo(mfmidi::tempo tempo)
+            {
+                Pauser pauser{*this};
+                catch_up(); // time before the change is played at the old tempo
+                for (auto& info : _playheads) {
+                    info.playhead->set_tempo(tempo);
+                }
+                rebuild_schedule();
+                bool finished = false;
+                while (tick_all(finished)) {
+                }
+                _output.flush();
+                if (finished) {
+                    remove_finished();
+                }
+            }
+
+            /// \brief Play from the current position on the calling thread, as fast as possible
+            ///
+            /// Time jumps from a deadline to the next one without waiting. Handlers see
+            /// events as in real time playback. The player thread is paused meanwhile and
+            /// posted commands are not applied.
+            ///
+            /// \param sink Called as \c sink(time, device, msg) for every message instead of
+            ///             sending it, \c time is the exact base time of the message and
+            ///             \c device is nullptr for playheads without a device
+            /// \param until Stop when base time would pass it, playheads are then at \a until
+            ///
+            /// A loop is played over and over. Base time then goes back at every restart,
+            /// so \a time and \a until count from the current base time as if the loop was
+            /// unrolled.
+            ///
+            /// \throw std::invalid_argument A loop is set and \a until is not
+            template <std::invocable<Time, midi_device*, message_ref> Sink>
+            void render_offline(Sink&& sink, Time until = Time::max())
+            {
+                render_offline_impl(until, true, [&sink](Time time, midi_device* device, std::span<const message_ref> msgs) {
+                    for (message_ref msg : msgs) {
+                        std::invoke(sink, time, device, msg);
+                    }
+                });
+            }
+
+            /// \brief Play to devices as fast as possible, see render_offline(Sink&&, Time)
+            void render_offline(Time until = Time::max())
+            {
+                render_offline_impl(until, false, [](Time /*unused*/, midi_device* device, std::span<const message_ref> msgs) {
+                    if (device != nullptr) {
+                        device->send_batch(msgs);
+                    }
+                });
+            }
+
+            /// \name Commands
+            /// Control without stopping the player thread. Commands are applied in order by
+            /// the player thread, at the beginning of its next wakeup, which comes within
+            /// command_latency(). Timed commands are applied right after the events of
+            /// their time are sent. Every function here is lock-free and thread safe.
+            ///
+            /// Other setters of the group park the player thread and wait for it, which
+            /// takes up to command_latency(). They must not be called concurrently, nor while
+            /// holding a lock that the playhead removal handler takes.
+            /// \{
+
+            /// \brief Run \a action on the player thread, it must not throw
+            void post(std::function<void(track_playhead_group&)> action)
+            {
+                _commands.emplace(std::move(action), std::nullopt);
+                wake();
+            }
+
+            /// \brief Run \a action on the player thread when base time reaches \a at
+            void post_at(Time at, std::function<void(track_playhead_group&)> action)
+            {
+                _commands.emplace(std::move(action), at);
+                wake();
+            }
+
+            /// \brief Run \a action on the player thread when the first playhead reaches \a tick
+            ///
+            /// The tick is converted by the player thread, \a action is dropped if the first
+            /// playhead has no tempo map then.
+            void post_at_tick(uint64_t tick, std::function<void(track_playhead_group&)> action)
+            {
+                post([tick, action = std::move(action)](track_playhead_group& group) mutable {
+                    if (group._playheads.empty() || group._playheads.front().playhead->tempo_map() == nullptr) {
+                        return;
+                    }
+                    const playhead_info& info = group._playheads.front();
+                    group.post_at(info.playhead->tempo_map()->tick_to_time(tick) - info.offest, std::move(action));
+                });
+            }
+
+            void post_play()
+            {
+                init_thread();
+                post([](track_playhead_group& group) {
+                    if (!group._playheads.empty()) {
+                        group._play.test_and_set();
+                    }
+                });
+            }
+
+            void post_pause()
+            {
+                post([](track_playhead_group& group) { group.pause(); });
+            }
+
+            /// \brief Seeking out of range is ignored
+            void post_seek(Time target)
+            {
+                post([target](track_playhead_group& group) {
+                    try {
+                        group.seek(target);
+                    } catch (const std::out_of_range&) {
+                    }
+                });
+            }
+
+            /// \brief Loop as set_loop(), which throws the same
+            ///
+            /// The loop is prepared on the calling thread and only installed by the player
+            /// thread. Copying positions of the playheads waits for the player thread as
+            /// other setters do, without stopping playback.
+            void post_set_loop(Time start, Time end)
+            {
+                if (end <= start) {
+                    throw std::invalid_argument{"post_set_loop: end must be after start"};
+                }
+                auto loop = std::make_shared<loop_state>(make_loop(start, end));
+                post([loop](track_playhead_group& group) {
+                    group._loop        = std::move(*loop);
+                    group._timeToSlept = 0ns;
+                });
+            }
+
+            void post_clear_loop()
+            {
+                post([](track_playhead_group& group) { group.clear_loop(); });
+            }
+
+            void post_set_tempo(mfmidi::tempo tempo)
+            {
+                post([tempo](track_playhead_group& group) { group.set_tempo(tempo); });
+            }
+
+            void post_set_device(midi_device* device)
+            {
+                post([device](track_playhead_group& group) { group.set_device(device); });
+            }
+
+            void post_set_router(const port_router* router)
+            {
+                post([router](track_playhead_group& group) { group.set_router(router); });
+            }
+
+            void post_set_track(const Track* track)
+            {
+                post([track](track_playhead_group& group) { group.set_track(track); });
+            }
+
+            void post_set_tempo_map(const mfmidi::tempo_map* map)
+            {
+                post([map](track_playhead_group& group) { group.set_tempo_map(map); });
+            }
+
+            [[nodiscard]] Time command_latency() const noexcept { return _command_latency; }
+
+            [[nodiscard]] double rate() const noexcept
+            {
+                return _requested_rate.load(std::memory_order_relaxed);
+            }
+
+            /// \brief Play \a rate times faster, such as 0.25 to 16
+            ///
+            /// Applied between group time and the clock, in O(1) at the next wakeup of the
+            /// player thread. Tick to time conversion of playheads is not touched, so
+            /// times given to seek(), base_time() and timed commands stay in song time.
+            /// Lock-free and thread safe.
+            ///
+            /// \throw std::invalid_argument \a rate is not positive and finite
+            void set_rate(double rate)
+            {
+                if (!(rate > 0.0) || !std::isfinite(rate)) {
+                    throw std::invalid_argument{"set_rate: rate must be positive and finite"};
+                }
+                _requested_rate.store(rate, std::memory_order_relaxed);
+                wake();
+            }
+
+            [[nodiscard]] const std::optional<overload_policy>& get_overload_policy() const noexcept { return _overload_policy; }
+
+            /// \brief Drop notes while the player thread cannot keep up, std::nullopt to never drop (default)
+            ///
+            /// When a wakeup is later than the threshold, note ons outside the budget of
+            /// \a policy are dropped with their note offs, until wakeups are on time again.
+            /// Other messages are always sent.
+            void set_overload_policy(std::optional<overload_policy> policy)
+            {
+                Pauser pauser{*this};
+                _overload_policy = policy;
+                leave_overload();
+            }
+
+            /// \brief Whether notes are being dropped, thread safe
+            [[nodiscard]] bool overloaded() const noexcept
+            {
+                return _overloaded.load(std::memory_order_relaxed);
+            }
+
+            /// \brief Count of note ons and offs dropped by the overload policy, thread safe
+            [[nodiscard]] uint64_t skipped_events() const noexcept
+            {
+                return _output.skipped();
+            }
+
+            void reset_skipped_events() noexcept
+            {
+                _output.reset_skipped();
+            }
+
+            /// \brief Counters of the player thread, readable from any thread without locking
+            ///
+            /// Lateness is measured on the clock of the group, send time on the monotonic
+            /// clock. render_offline() is not counted.
+            [[nodiscard]] const player_metrics& metrics() const noexcept
+            {
+                return _metrics;
+            }
+
+            /// \brief Clear the counters, thread safe
+            void reset_metrics() noexcept
+            {
+                _metrics.reset();
+            }
+
+            /// \brief Longest wait of the player thread, so commands are not delayed more, default 10ms
+            void set_command_latency(Time latency)
+            {
+                Pauser pauser{*this};
+                _command_latency = std::clamp(latency, Time{1ms}, Time{MAX_SLEEP});
+            }
+
+            /// \}
+
+            void init_thread()
+            {
+                if (!_thread.joinable()) {
+                    _thread = std::jthread([this](const std::stop_token& stop) {
+                        _thread_options_result = apply_thread_options(_thread_options);
+                        playThread(stop);
+                    });
+                }
+            }
+
+            /// \brief Start the player thread with \a options, they are kept if the thread already runs
+            void init_thread(player_thread_options options)
+            {
+                if (!_thread.joinable()) {
+                    _thread_options = std::move(options);
+                }
+                init_thread();
+            }
+
+            [[nodiscard]] const player_thread_options& thread_options() const noexcept { return _thread_options; }
+
+            /// \brief Result of apply_thread_options in the player thread, 0 if succeeded
+            [[nodiscard]] int thread_options_result() const noexcept { return _thread_options_result; }
+
         private:
+            /// \brief Messages restoring the chase state of every source
+            ///
+            /// A track is split at its Output Port events, so every message is chased on
+            /// the port it was sent to. States with the same device and port are merged,
+            /// then every message goes to its routed device by \a router.
+            static std::vector<chase_batch> chase_batches(std::span<const chase_source> sources, const port_router* router)
+            {
+                struct routed_state {
+                    midi_device* device;
+                    uint16_t     port;
+                    chase_state  state;
+                };
+                std::vector<routed_state> states;
+                auto                      merge_into = [&](midi_device* device, uint16_t port, const chase_state& state) {
+                    if (device == nullptr && (router == nullptr || port == no_output_port)) {
+                        return; // nowhere to send it
+                    }
+                    auto found = std::ranges::find_if(states, [&](const routed_state& other) { return other.device == device && other.port == port; });
+                    if (found == states.end()) {
+                        states.push_back({device, port, state});
+                    } else {
+                        found->state.merge(state);
+                    }
+                };
+
+                chase_state segment_state;
+                for (const auto& [track, device, at] : sources) {
+                    if (device == nullptr && router == nullptr) {
+                        continue;
+                    }
+                    uint16_t port  = no_output_port;
+                    uint64_t tick  = 0;
+                    auto     first = std::ranges::begin(*track);
+                    for (auto it = first; it != at.nextmsg; ++it) {
+                        if (!is_output_port_at(it)) {
+                            continue;
+                        }
+                        segment_state.clear();
+                        tick = segment_state.process(first, it, tick);
+                        merge_into(device, port, segment_state);
+                        auto&& msg = *it;
+                        tick += msg.delta_time();
+                        port  = msg.output_port();
+                        first = std::next(it);
+                    }
+                    segment_state.clear();
+                    segment_state.process(first, at.nextmsg, tick);
+                    merge_into(device, port, segment_state);
+                }
+
+                std::vector<chase_batch>         result;
+                std::vector<std::vector<size_t>> ends; // of messages in bytes, parallel to result
+                for (const auto& [device, port, state] : states) {
+                    state.emit([&](std::span<const uint8_t> msg) {
+                        midi_device* target = router != nullptr ? router->device(port, msg, device) : device;
+                        if (target == nullptr) {
+                            return;
+                        }
+                        auto found = std::ranges::find(result, target, &chase_batch::device);
+                        if (found == result.end()) {
+                            result.push_back({target, {}, {}});
+                            ends.emplace_back();
+                            found = result.end() - 1;
+                        }
+                        found->bytes.insert(found->bytes.end(), msg.begin(), msg.end());
+                        ends[found - result.begin()].push_back(found->bytes.size());
+                    });
+                }
+                for (size_t index = 0; index < result.size(); ++index) {
+                    size_t begin = 0;
+                    for (size_t end : ends[index]) {
+                        result[index].msgs.emplace_back(result[index].bytes.data() + begin, end - begin);
+                        begin = end;
+                    }
+                }
+                return result;
+            }
+
+            /// \brief Whether the event at \a it is an Output Port event, other events are not built if the iterator knows their status
+            template <class It>
+            static bool is_output_port_at(const It& it)
+            {
+                if constexpr (requires {
+                                  { it.running_status() } -> std::convertible_to<uint8_t>;
+                              }) {
+                    if (it.running_status() != MIDIMsgStatus::META_EVENT) {
+                        return false;
+                    }
+                }
+                return (*it).is_output_port();
+            }
+
+            /// \brief Jump every playhead back to the loop start, at _now
+            ///
+            /// Note offs and the chase state are queued before the events at the start.
+            void restart_loop()
+            {
+                _output.add_note_offs();
+                const loop_state& loop = *_loop;
+                for (size_t index = 0; index < _playheads.size(); ++index) {
+                    Playhead& playhead = *_playheads[index].playhead;
+                    if (index < loop.entries.size() && is_loop_entry_of(loop.entries[index], playhead)) {
+                        if (playhead.track() != nullptr) {
+                            playhead.restore_snapshot(loop.entries[index].start);
+                        }
+                    } else if (playhead.track() != nullptr) {
+                        playhead.seek(loop.region.start + _playheads[index].offest);
+                    }
+                    _hot[index].ticked = _now;
+                }
+                if (_chase_on_seek) {
+                    for (const auto& batch : loop.chase) {
+                        for (message_ref msg : batch.msgs) {
+                            _output.add(batch.device, msg);
+                        }
+                    }
+                }
+                reschedule();
+            }
+
+            static bool is_loop_entry_of(const typename loop_state::entry& entry, const Playhead& playhead)
+            {
+                if (entry.playhead != &playhead || entry.track != playhead.track() || entry.division.data() != playhead.division().data() || entry.tempo_map != playhead.tempo_map()) {
+                    return false;
+                }
+                if (playhead.tempo_map() != nullptr) {
+                    return true;
+                }
+                const auto timing = playhead.save_snapshot(); // the start snapshot would restore the tempo of set_loop
+                return timing.tempo.mspq() == entry.start.tempo.mspq() && timing.anchor_tick == entry.start.anchor_tick && timing.anchor_time == entry.start.anchor_time;
+            }
+
+            /// \brief Loop state of every playhead at \a start, built while playback goes on
+            loop_state make_loop(Time start, Time end)
+            {
+                struct source {
+                    const Playhead*             playhead;
+                    const Track*                track;
+                    mfmidi::division            division;
+                    const mfmidi::tempo_map*    tempo_map;
+                    typename Playhead::snapshot timing;
+                    Time                        offest;
+                    midi_device*                device;
+                };
+                std::vector<source> sources;
+                const port_router*  router = nullptr;
+                {
+                    Parker parker{*this}; // only copies, the scans below run unparked
+                    router = _router;
+                    sources.reserve(_playheads.size());
+                    for (const auto& info : _playheads) {
+                        const Playhead& playhead = *info.playhead;
+                        if (Playhead::tempo_changed_aware && playhead.track() != nullptr && playhead.tempo_map() == nullptr) {
+                            throw std::logic_error{"set_loop: a tempo map is required when the handler changes tempo"};
+                        }
+                        sources.push_back({&playhead, playhead.track(), playhead.division(), playhead.tempo_map(), playhead.save_snapshot(), info.offest, playhead.device()});
+                    }
+                }
+
+                loop_state                loop;
+                std::vector<chase_source> chase;
+                loop.region = {start, end};
+                loop.entries.reserve(sources.size());
+                for (const auto& src : sources) {
+                    auto& entry = loop.entries.emplace_back(src.playhead, src.track, src.division, src.tempo_map);
+                    if (src.track != nullptr) {
+                        entry.start = Playhead::snapshot_at(*src.track, src.division, src.tempo_map, src.timing, start + src.offest);
+                        chase.push_back({src.track, src.device, entry.start});
+                    }
+                }
+                loop.chase = chase_batches(chase, router);
+                return loop;
+            }
+
+            /// \brief Restore the last snapshot before \a target if it is closer than current position
+            static void jump_to_snapshot(const seek_cache& cache, Playhead& playhead, Time target)
+            {
+                auto found = cache.entries.find(&playhead);
+                if (found == cache.entries.end()) {
+                    return;
+                }
+                const auto& entry = found->second;
+                if (entry.track != playhead.track() || entry.division.data() != playhead.division().data() || entry.tempo_map != playhead.tempo_map()) {
+                    return;
+                }
+                if (playhead.tempo_map() == nullptr && !has_default_timing(playhead)) {
+                    return; // snapshots are timed at the default tempo, see Playhead::build_snapshots
+                }
+                auto next = std::ranges::upper_bound(entry.snapshots, target, {}, &Playhead::snapshot::playtime);
+                if (next == entry.snapshots.begin()) {
+                    return;
+                }
+                const auto& snap = *std::prev(next);
+                if (target < playhead.playtime() || snap.playtime > playhead.playtime()) {
+                    playhead.restore_snapshot(snap);
+                }
+            }
+
+            /// \brief Whether \a playhead times events at 120 bpm from tick 0, as when no tempo was set
+            static bool has_default_timing(const Playhead& playhead)
+            {
+                const auto timing = playhead.save_snapshot();
+                return timing.tempo.mspq() == (120_bpm).mspq() && timing.anchor_time == ticks_to_duration(playhead.division(), 120_bpm, timing.anchor_tick);
+            }
+
             void playThread(const std::stop_token& token)
             {
                 while (!token.stop_requested()) {
@@ -563,53 +1780,387 @@ namespace mfmidi {
                             // info.playhead->notify(NotifyType::T_Mode);
                             // todo: emit something
                         }
-                        {
-                            std::unique_lock<std::mutex> lck(_mutex);
-                            _condvar.wait(lck, [this] { return _wakeup; });
-                            _wakeup = false;
+                        leave_overload();
+                        while (!token.stop_requested()) {
+                            const uint32_t seen = _signal.load(std::memory_order_acquire);
+                            park_if_requested();
+                            run_commands();
+                            run_release_notes();
+                            if (_play.test()) {
+                                break;
+                            }
+                            _signal.wait(seen, std::memory_order_acquire);
                         }
                         if (_play.test()) {
-                            // todo: handle starting play
+                            _rate = _requested_rate.load(std::memory_order_relaxed);
+                            reanchor(_clock->now());
+                            _metrics.restart_rate(_clock->now());
                             enable_thread_responsiveness();
                         }
                     } else {
-                        auto begin = hiresticktime();
-                        Time sleep = 0ns;
-                        if (_compensation < _timeToSlept) {
-                            sleep = _timeToSlept - _compensation;
-                            nanosleep(sleep); // because _lastSleptTime may be changed (such as when revert snapshot)
-                            _compensation = 0ns;
-                        } else {
-                            _compensation -= _timeToSlept;
+                        if (park_if_requested()) {
+                            continue;
                         }
-                        std::chrono::nanoseconds minTime = std::chrono::nanoseconds::max();
-
-                        auto end = _playheads.end();
-                        for (auto it = _playheads.begin(); it != end; ++it) {
-                        STARTLOOP_13:
-                        	auto&& ev = *it;
-                            Time interval = ev.playhead->tick(_timeToSlept);
-                            if (interval == Time::max()) {
-                                if (_rhandler) {
-                                    _rhandler(std::move(ev));
-                                }
-                                it = _playheads.erase(it);
-                                end = _playheads.end();
-                                goto STARTLOOP_13;
-                            }
-                            minTime = std::min(minTime, interval);
+                        run_commands();
+                        if (!_play.test()) {
+                            continue;
+                        }
+                        run_release_notes();
+                        rebuild_schedule();
+                        apply_rate();
+                        _now += _timeToSlept;
+                        _clock->sleep_until(wall_time(_now)); // late wakeups shorten the next wait
+                        if (_park_requests.load() != 0) {
+                            // keep the time actually played, nothing is due before the planned _now
+                            _now         = std::min(_now, _anchor_now + group_duration(_clock->now() - _anchor_wall));
+                            _timeToSlept = 0ns;
+                            park_if_requested();
+                            continue;
                         }
-                        if (minTime == Time::max()) {
+                        const Time woke = _clock->now();
+                        _metrics.record_wakeup(woke - wall_time(_now));
+                        _metrics.update_rate(woke);
+                        if (_overload_policy) {
+                            update_overload(woke - wall_time(_now));
+                        }
+                        if (_loop && !_playheads.empty() && base_time() >= _loop->region.end) {
+                            restart_loop(); // before ticking, events at the end are not played
+                        }
+
+                        bool finished = false;
+                        bool retime   = tick_due(finished);
+                        while (retime) {
+                            retime = tick_all(finished);
+                        }
+                        if (const size_t batch = _output.size(); batch != 0) {
+                            const Time send_begin = hiresticktime();
+                            _output.flush(); // simultaneous events, across playheads
+                            _metrics.record_send(batch, hiresticktime() - send_begin);
+                        }
+                        if (finished) {
+                            remove_finished();
+                        }
+                        _metrics.playheads.store(_schedule.size(), std::memory_order_relaxed);
+
+                        if (_schedule.empty() && !_loop) {
                             _play.clear();
+                            if (_release_notes_on_stop) {
+                                _output.release_notes();
+                            }
                             continue;
                         }
-                        minTime          = std::min(minTime, MAX_SLEEP);
-                        _timeToSlept     = minTime;
-                        auto now         = hiresticktime();
-                        auto elapsedtime = now - begin - sleep;
-                        _compensation += elapsedtime;
+                        run_timed_commands();
+                        if (_reschedule) {
+                            _timeToSlept = 0ns; // a command changed playback data
+                            continue;
+                        }
+                        _timeToSlept = group_duration(std::min(MAX_SLEEP, _command_latency));
+                        if (!_schedule.empty()) {
+                            _timeToSlept = std::min(_schedule.front().deadline - _now, _timeToSlept);
+                        }
+                        if (!_timed_commands.empty()) {
+                            _timeToSlept = std::clamp(_timed_commands.front().at.value() - base_time(), Time{}, _timeToSlept);
+                        }
+                        if (_loop && !_playheads.empty()) {
+                            _timeToSlept = std::clamp(_loop->region.end - base_time(), Time{}, _timeToSlept);
+                        }
+                    }
+                }
+            }
+
+            template <class Visitor>
+            void render_offline_impl(Time until, bool keep_deviceless, Visitor&& visitor)
+            {
+                Pauser pauser{*this};
+                if (_loop && until == Time::max()) {
+                    throw std::invalid_argument{"render_offline: until is required while looping"};
+                }
+                rebuild_schedule();
+                if (_playheads.empty()) {
+                    return;
+                }
+                const Time start_now  = _now;
+                const Time start_base = base_time();
+                const Time last       = until == Time::max() ? Time::max() : start_now + (until - start_base);
+
+                _output.set_keep_deviceless(keep_deviceless);
+                while (true) {
+                    Time next = _schedule.empty() ? Time::max() : _schedule.front().deadline;
+                    if (_loop && !_playheads.empty()) {
+                        next = std::min(next, _now + std::max(Time{}, _loop->region.end - base_time()));
+                    }
+                    if (next == Time::max() || next > last) {
+                        break;
+                    }
+                    _now = next;
+                    if (_loop && !_playheads.empty() && base_time() >= _loop->region.end) {
+                        restart_loop();
                     }
+                    bool finished = false;
+                    bool retime   = tick_due(finished);
+                    while (retime) {
+                        retime = tick_all(finished);
+                    }
+                    const Time time = start_base + (_now - start_now);
+                    _output.flush([&](midi_device* device, std::span<const message_ref> msgs) { visitor(time, device, msgs); });
+                    if (finished) {
+                        remove_finished();
+                    }
+                }
+                _output.set_keep_deviceless(false);
+                if (last != Time::max() && _now < last) {
+                    _now          = last;
+                    bool finished = false;
+                    tick_all(finished); // move every playhead to until, nothing is due
+                }
+                _timeToSlept = 0ns;
+                _reschedule  = true;
+            }
+
+            /// \brief Wait until the player thread is parked, see Pauser and Parker
+            void park()
+            {
+                _park_requests.fetch_add(1);
+                if (!_thread.joinable() || std::this_thread::get_id() == _thread.get_id()) {
+                    return; // nothing runs concurrently
+                }
+                wake();
+                while (!_parked.load()) {
+                    _parked.wait(false);
+                }
+            }
+
+            void unpark()
+            {
+                if (_park_requests.fetch_sub(1) == 1) {
+                    _park_requests.notify_all();
+                }
+            }
+
+            /// \brief Stay parked while a Pauser or Parker is alive
+            /// \return Playback data may have changed
+            bool park_if_requested()
+            {
+                if (_park_requests.load() == 0) {
+                    return false;
+                }
+                do {
+                    _parked.store(true);
+                    _parked.notify_all();
+                    for (uint32_t requests = _park_requests.load(); requests != 0; requests = _park_requests.load()) {
+                        _park_requests.wait(requests);
+                    }
+                    _parked.store(false);
+                } while (_park_requests.load() != 0); // a request which came meanwhile saw _parked
+                return true;
+            }
+
+            /// \brief Pause without releasing notes, for changes which do not stop playback
+            bool suspend()
+            {
+                bool play = _play.test();
+                _play.clear();
+                return play;
+            }
+
+            void wake()
+            {
+                _signal.fetch_add(1, std::memory_order_release);
+                _signal.notify_all();
+            }
+
+            /// \brief Apply posted commands, timed ones are kept for later
+            void run_commands()
+            {
+                while (auto posted = _commands.pop()) {
+                    if (posted->at) {
+                        auto pos = std::ranges::upper_bound(_timed_commands, *posted->at, {}, [](const command& cmd) { return *cmd.at; });
+                        _timed_commands.insert(pos, std::move(*posted));
+                    } else {
+                        posted->action(*this);
+                    }
+                }
+                _metrics.timed_commands.store(_timed_commands.size(), std::memory_order_relaxed);
+            }
+
+            /// \brief Enter or leave overload by lateness of this wakeup
+            void update_overload(Time late)
+            {
+                const bool overloaded = _overloaded.load(std::memory_order_relaxed);
+                if (overloaded ? late < _overload_policy->threshold / 2 : late > _overload_policy->threshold) {
+                    _overloaded.store(!overloaded, std::memory_order_relaxed);
+                    _output.set_note_budget(overloaded ? std::nullopt : std::optional{details::output_batch::note_budget{_overload_policy->min_velocity, _overload_policy->max_polyphony}});
+                }
+            }
+
+            void leave_overload()
+            {
+                _overloaded.store(false, std::memory_order_relaxed);
+                _output.set_note_budget(std::nullopt);
+            }
+
+            void run_release_notes()
+            {
+                if (_release_notes.exchange(false, std::memory_order_acquire)) {
+                    _output.release_notes();
+                }
+            }
+
+            void run_timed_commands()
+            {
+                size_t count = 0;
+                while (count < _timed_commands.size() && !_playheads.empty() && *_timed_commands[count].at <= base_time()) {
+                    _timed_commands[count].action(*this);
+                    ++count;
+                }
+                _timed_commands.erase(_timed_commands.begin(), _timed_commands.begin() + static_cast<std::ptrdiff_t>(count));
+                _metrics.timed_commands.store(_timed_commands.size(), std::memory_order_relaxed);
+            }
+
+            /// \brief Playheads were moved to a new position at _now, the time since their last tick is not owed
+            void restart_timing()
+            {
+                for (auto& hot : _hot) {
+                    hot.ticked = _now;
+                }
+                _timeToSlept = 0ns;
+                _reschedule  = true;
+            }
+
+            /// \brief Tick playheads which lag behind _now, none of them is due
+            void catch_up()
+            {
+                for (auto& hot : _hot) {
+                    if (hot.ticked != _now) {
+                        tick_playhead(hot);
+                    }
+                }
+            }
+
+            /// \brief Build the schedule again if playback data changed
+            void rebuild_schedule()
+            {
+                if (!_reschedule) {
+                    return;
+                }
+                _reschedule = false;
+                catch_up();
+                reschedule();
+                _timeToSlept = 0ns;
+                reanchor(_clock->now());
+            }
+
+            void reanchor(Time wall) noexcept
+            {
+                _anchor_now  = _now;
+                _anchor_wall = wall;
+            }
+
+            /// \brief Clock time of group time \a time
+            [[nodiscard]] Time wall_time(Time time) const noexcept
+            {
+                const auto elapsed = static_cast<double>((time - _anchor_now).count()) / _rate;
+                return _anchor_wall + Time{static_cast<Time::rep>(std::llround(elapsed))};
+            }
+
+            /// \brief Group time elapsed during \a wall of clock time
+            [[nodiscard]] Time group_duration(Time wall) const noexcept
+            {
+                return Time{static_cast<Time::rep>(std::llround(static_cast<double>(wall.count()) * _rate))};
+            }
+
+            /// \brief Take a rate change at the current group time, nothing is retimed
+            void apply_rate() noexcept
+            {
+                const double requested = _requested_rate.load(std::memory_order_relaxed);
+                if (requested != _rate) {
+                    reanchor(wall_time(_now)); // continuous at the change
+                    _rate = requested;
+                }
+            }
+
+            Time tick_playhead(hot_playhead& hot)
+            {
+                Time interval = hot.playhead->tick(_now - hot.ticked);
+                hot.ticked    = _now;
+                return interval;
+            }
+
+            /// \brief Tick playheads whose deadline is reached
+            /// \return A playhead changed tempo, every playhead has to be ticked
+            bool tick_due(bool& finished)
+            {
+                bool retime = false;
+                while (!_schedule.empty() && _schedule.front().deadline <= _now) {
+                    std::ranges::pop_heap(_schedule, std::ranges::greater{});
+                    auto& entry    = _schedule.back();
+                    Time  interval = tick_playhead(_hot[entry.index]);
+                    if (interval == Time::max()) {
+                        finished = true;
+                        _schedule.pop_back();
+                        continue;
+                    }
+                    retime         = retime || interval == 0ns;
+                    entry.deadline = _now + interval;
+                    std::ranges::push_heap(_schedule, std::ranges::greater{});
+                }
+                return retime;
+            }
+
+            /// \brief Bring every playhead to _now, so they are all retimed
+            bool tick_all(bool& finished)
+            {
+                bool retime = false;
+                for (auto& entry : _schedule) {
+                    Time interval = tick_playhead(_hot[entry.index]);
+                    if (interval == Time::max()) {
+                        finished       = true;
+                        entry.deadline = Time::max();
+                        continue;
+                    }
+                    retime         = retime || interval == 0ns;
+                    entry.deadline = _now + interval;
+                }
+                std::erase_if(_schedule, [](const schedule_entry& entry) { return entry.deadline == Time::max(); });
+                std::ranges::make_heap(_schedule, std::ranges::greater{});
+                return retime;
+            }
+
+            /// \brief Pass finished playheads to the removal handler, all at once
+            void remove_finished()
+            {
+                if (_loop) {
+                    return; // played again from the loop start
+                }
+                size_t kept = 0;
+                for (size_t index = 0; index < _playheads.size(); ++index) {
+                    if (!_hot[index].playhead->eof()) {
+                        if (kept != index) {
+                            _playheads[kept] = std::move(_playheads[index]);
+                            _hot[kept]       = _hot[index];
+                        }
+                        ++kept;
+                        continue;
+                    }
+                    _playheads[index].playhead->set_output_batch(nullptr);
+                    if (_rhandler) {
+                        _rhandler(std::move(_playheads[index])); // may destroy it, its hot entry is dropped below
+                    }
+                }
+                _playheads.erase(_playheads.begin() + static_cast<std::ptrdiff_t>(kept), _playheads.end());
+                _hot.resize(kept);
+                reschedule(); // indexes changed
+            }
+
+            void reschedule()
+            {
+                _schedule.clear();
+                _schedule.reserve(_playheads.size());
+                for (size_t index = 0; index < _playheads.size(); ++index) {
+                    const hot_playhead& hot = _hot[index];
+                    _schedule.push_back({hot.playhead->eof() ? hot.ticked : hot.ticked + hot.playhead->sleeptime(), index});
                 }
+                std::ranges::make_heap(_schedule, std::ranges::greater{});
             }
         };
 
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <iostream>
@@ -6,6 +7,13 @@
 #include "mfmidi/timingapi.hpp"
 
 #if defined(_UNIX)
+#include <alloca.h>
+#include <cerrno>
+#include <ctime>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
 #include <unistd.h>
 #elif defined(_WIN32)
 #define WIN32_LEAN_AND_MEAN
@@ -13,25 +21,99 @@
 #include <Windows.h>
 
 #include <avrt.h>
+#include <malloc.h>
 #include <synchapi.h>
 #endif
 
 namespace mfmidi {
+    namespace {
+        constexpr std::size_t prefault_page_size   = 4096;
+        constexpr std::size_t prefault_stack_margin = 64 * 1024; // for frames called after prefaulting
+
+        /// \brief Bytes of \a requested that fit in \a left bytes of stack
+        constexpr std::size_t prefault_fit(std::size_t requested, std::size_t left) noexcept
+        {
+            return left > prefault_stack_margin ? std::min(requested, left - prefault_stack_margin) : 0;
+        }
+    }
+
+    void prefault_memory(void* data, std::size_t size) noexcept
+    {
+        auto* bytes = static_cast<volatile unsigned char*>(data);
+        for (std::size_t offset = 0; offset < size; offset += prefault_page_size) {
+            bytes[offset] = bytes[offset]; // read and write, so copy-on-write pages are faulted too
+        }
+        if (size != 0) {
+            bytes[size - 1] = bytes[size - 1];
+        }
+    }
+
 #if defined(_POSIX_VERSION)
+    namespace {
+        timespec to_timespec(std::chrono::nanoseconds nsec)
+        {
+            timespec ts{};
+            ts.tv_sec  = static_cast<time_t>(nsec.count() / 1'000'000'000);
+            ts.tv_nsec = static_cast<long>(nsec.count() % 1'000'000'000);
+            return ts;
+        }
+
+        /// \brief Bytes of stack below the caller, SIZE_MAX if unknown
+        std::size_t stack_left() noexcept
+        {
+            const char here{};
+            const auto top = reinterpret_cast<std::uintptr_t>(&here);
+#if defined(__linux__)
+            pthread_attr_t attr;
+            if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+                void*       addr  = nullptr;
+                std::size_t size  = 0;
+                const int   error = pthread_attr_getstack(&attr, &addr, &size);
+                pthread_attr_destroy(&attr);
+                if (error == 0) {
+                    return top - reinterpret_cast<std::uintptr_t>(addr);
+                }
+            }
+#elif defined(__APPLE__)
+            const auto stack_top = reinterpret_cast<std::uintptr_t>(pthread_get_stackaddr_np(pthread_self()));
+            return top - (stack_top - pthread_get_stacksize_np(pthread_self()));
+#endif
+            rlimit limit{};
+            if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+                return static_cast<std::size_t>(limit.rlim_cur); // whole stack, an upper bound
+            }
+            return SIZE_MAX;
+        }
+    }
+
     int nanosleep(std::chrono::nanoseconds nsec)
     {
-        static timespec ts{};
-        /* ts.tv_sec = nsec.count() / 1'000'000'000;
-        ts.tv_nsec = nsec.count() % 1'000'000'000; */
-        ts.tv_nsec = nsec.count();
-        return ::nanosleep(&ts, nullptr);
+        if (nsec <= std::chrono::nanoseconds::zero()) {
+            return 0;
+        }
+        timespec ts = to_timespec(nsec);
+        while (::nanosleep(&ts, &ts) != 0) {
+            if (errno != EINTR) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    int sleep_until(std::chrono::nanoseconds deadline)
+    {
+        const timespec ts = to_timespec(deadline);
+        int            result;
+        while ((result = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr)) == EINTR) {
+        }
+        return result;
     }
 
     std::chrono::nanoseconds hiresticktime()
     {
-        static timespec ts;
-        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
-        return std::chrono::nanoseconds{ts.tv_sec * 1'000'000'000 + ts.tv_nsec};
+        timespec ts{};
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return std::chrono::nanoseconds{ts.tv_sec * 1'000'000'000LL + ts.tv_nsec};
     }
 
     int enable_thread_responsiveness()
@@ -45,6 +127,60 @@ namespace mfmidi {
         // todo: implement it
         return 0;
     }
+
+    int apply_thread_options(const player_thread_options& options)
+    {
+        int  result = 0;
+        auto fail   = [&result](int error) {
+            if (result == 0) {
+                result = error;
+            }
+        };
+
+        if (options.policy != player_thread_options::scheduling_policy::normal) {
+            const int policy = options.policy == player_thread_options::scheduling_policy::fifo ? SCHED_FIFO : SCHED_RR;
+            const int low    = sched_get_priority_min(policy);
+            const int high   = sched_get_priority_max(policy);
+
+            sched_param param{};
+            param.sched_priority = options.priority == 0 ? (low + high) / 2 : std::clamp(options.priority, low, high);
+            if (int error = pthread_setschedparam(pthread_self(), policy, &param); error != 0) {
+                fail(error);
+            }
+        }
+
+        if (!options.cpus.empty()) {
+#if defined(__linux__)
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (unsigned cpu : options.cpus) {
+                if (cpu < CPU_SETSIZE) {
+                    CPU_SET(cpu, &set);
+                }
+            }
+            if (int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set); error != 0) {
+                fail(error);
+            }
+#else
+            fail(ENOTSUP);
+#endif
+        }
+
+        if (options.lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+            fail(errno);
+        }
+
+        if (options.prefault_stack != 0) {
+            const std::size_t size = prefault_fit(options.prefault_stack, stack_left());
+            if (size != options.prefault_stack) {
+                fail(ERANGE);
+            }
+            if (size != 0) {
+                prefault_memory(alloca(size), size);
+            }
+        }
+        return result;
+    }
 #elif defined(_WIN32)
     int nanosleep(std::chrono::nanoseconds nsec)
     {
@@ -141,6 +277,15 @@ namespace mfmidi {
         return std::chrono::nanoseconds{static_cast<unsigned long long>(tick / (freq / 1e9))};
     }
 
+    int sleep_until(std::chrono::nanoseconds deadline)
+    {
+        const auto now = hiresticktime();
+        if (deadline <= now) {
+            return 0;
+        }
+        return nanosleep(deadline - now);
+    }
+
     thread_local DWORD  mmcss_task_index{};
     thread_local HANDLE mmcss_task_handle{};
 
@@ -160,6 +305,53 @@ namespace mfmidi {
         }
         return 0;
     }
+
+    int apply_thread_options(const player_thread_options& options)
+    {
+        int  result = 0;
+        auto fail   = [&result](DWORD error) {
+            if (result == 0) {
+                result = static_cast<int>(error);
+            }
+        };
+
+        if (options.policy != player_thread_options::scheduling_policy::normal) {
+            if (SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) == 0) {
+                fail(GetLastError());
+            }
+        }
+
+        if (!options.cpus.empty()) {
+            DWORD_PTR mask = 0;
+            for (unsigned cpu : options.cpus) {
+                if (cpu < sizeof(DWORD_PTR) * 8) {
+                    mask |= DWORD_PTR{1} << cpu;
+                }
+            }
+            if (SetThreadAffinityMask(GetCurrentThread(), mask) == 0) {
+                fail(GetLastError());
+            }
+        }
+
+        if (options.lock_memory) {
+            fail(ERROR_NOT_SUPPORTED); // no process wide equivalent of mlockall
+        }
+
+        if (options.prefault_stack != 0) {
+            ULONG_PTR low  = 0;
+            ULONG_PTR high = 0;
+            GetCurrentThreadStackLimits(&low, &high);
+            const char        here{};
+            const std::size_t size = prefault_fit(options.prefault_stack, reinterpret_cast<ULONG_PTR>(&here) - low);
+            if (size != options.prefault_stack) {
+                fail(ERROR_STACK_OVERFLOW);
+            }
+            if (size != 0) {
+                prefault_memory(_alloca(size), size);
+            }
+        }
+        return result;
+    }
 #else
     std::chrono::duration<unsigned long long, std::nano> hiresticktime()
     {
@@ -25,6 +25,23 @@ static_assert(sizeof(tempo) == 4);
 static_assert(sizeof(division) == 2);
 static_assert(static_cast<division>(0xE250).fps() == 30);
 static_assert(static_cast<division>(0xE250).tpf() == 80);
+static_assert(division{25, 40}.is_smpte() && division{25, 40}.fps() == 25 && division{25, 40}.tpf() == 40);
+
+// exact tick durations
+static_assert(ticks_to_duration(96_ppq, 120_bpm, 96) == std::chrono::milliseconds{500});
+static_assert(ticks_to_duration(480_ppq, tempo::from_mspq(500001), 480'000'000) == std::chrono::nanoseconds{500'001'000'000'000});
+static_assert(ticks_to_duration(division{29, 1}, tempo{}, 30000) == std::chrono::seconds{1001});
+static_assert(duration_to_ticks(96_ppq, 120_bpm, std::chrono::milliseconds{1499}) == 287);
+static_assert(duration_to_ticks(96_ppq, 120_bpm, std::chrono::milliseconds{1500}) == 288);
+
+// 29.97 drop frame time code
+static_assert(frames_to_timecode(1799, 29) == smpte_timecode{0, 0, 59, 29});
+static_assert(frames_to_timecode(1800, 29) == smpte_timecode{0, 1, 0, 2});
+static_assert(frames_to_timecode(17982, 29) == smpte_timecode{0, 10, 0, 0});
+static_assert(timecode_to_frames({0, 1, 0, 2}, 29) == 1800);
+static_assert(timecode_to_frames({1, 0, 0, 0}, 29) == 107892);
+static_assert(frames_to_timecode(107892, 29) == smpte_timecode{1, 0, 0, 0});
+static_assert(frames_to_timecode(90000, 25) == smpte_timecode{1, 0, 0, 0});
 
 int main()
 {
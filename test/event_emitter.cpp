@@ -0,0 +1,89 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "mfmidi/event.hpp"
+
+#include "test_utility.hpp"
+
+#include <vector>
+
+using namespace mfmidi;
+
+namespace {
+    struct first_event {
+        int value;
+    };
+
+    struct second_event {
+        int value;
+    };
+
+    using emitter = basic_flat_event_emitter<2, first_event, second_event>;
+}
+
+int main()
+{
+    std::vector<int> calls;
+    auto             handler = [&calls](int id) {
+        return [&calls, id](const first_event& ev) { calls.push_back(id * 10 + ev.value); };
+    };
+
+    emitter                     events;
+    std::vector<emitter::token> tokens;
+    for (int id = 1; id <= 4; ++id) { // 2 inline, 2 in overflow
+        tokens.push_back(events.add_event_handler(handler(id)));
+    }
+    events.add_event_handler([&calls](const second_event& ev) { calls.push_back(-ev.value); });
+
+    int failed = check(events.handler_count<first_event>() == 4 && events.handler_count<second_event>() == 1, "handler count");
+
+    events.emit(first_event{1});
+    failed += check(calls == std::vector{11, 21, 31, 41}, "order across inline and overflow");
+
+    calls.clear();
+    events.emit(second_event{5});
+    failed += check(calls == std::vector{-5}, "dispatch by event type");
+
+    calls.clear();
+    events.remove_event_handler(tokens[0]); // inline, the first overflow handler moves inline
+    events.emit(first_event{2});
+    failed += check(calls == std::vector{22, 32, 42}, "remove inline keeps order");
+
+    calls.clear();
+    events.remove_event_handler(tokens[3]); // overflow
+    events.remove_event_handler(tokens[2]); // promoted one
+    tokens.push_back(events.add_event_handler(handler(5)));
+    events.emit(first_event{3});
+    failed += check(calls == std::vector{23, 53}, "remove promoted and add again");
+    failed += check(events.handler_count<first_event>() == 2, "handler count after remove");
+
+    calls.clear();
+    events.add_event_handler([&calls](const auto& ev) { calls.push_back(100 + ev.value); }); // both types
+    events.emit(second_event{7});
+    failed += check(calls == std::vector{-7, 107}, "generic handler");
+
+    int                  firsts  = 0;
+    int                  seconds = 0;
+    static_event_emitter fixed{
+        [&firsts](const first_event& ev) { firsts += ev.value; },
+        [&seconds](const second_event& ev) { seconds += ev.value; },
+        [&firsts, &seconds](const auto& /*unused*/) { ++firsts, ++seconds; },
+    };
+    fixed.emit(first_event{10});
+    fixed.emit(second_event{20});
+    failed += check(firsts == 12 && seconds == 22, "static dispatch by event type");
+    return failed;
+}
@@ -0,0 +1,133 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "mfmidi/smf/span_track_index.hpp"
+#include "mfmidi/track_player.hpp"
+
+#include "test_utility.hpp"
+
+#include <array>
+#include <stdexcept>
+#include <vector>
+
+using namespace mfmidi;
+
+namespace {
+    constexpr std::array<uint8_t, 31> held_notes{
+        'M', 'T', 'r', 'k', 0, 0, 0, 23,
+        0x00, 0xC0, 0x05,       // program 5
+        0x60, 0x90, 0x3C, 0x40, // 500ms
+        0x60, 0x80, 0x3C, 0x40, // 1000ms
+        0x00, 0x90, 0x3E, 0x40, // held over the loop end
+        0x60, 0x80, 0x3E, 0x40, // 1500ms
+        0x00, 0xFF, 0x2F, 0x00  // end of track
+    };
+
+    constexpr std::array<uint8_t, 20> short_notes{
+        'M', 'T', 'r', 'k', 0, 0, 0, 12,
+        0x30, 0x91, 0x24, 0x40, // 250ms
+        0x60, 0x81, 0x24, 0x40, // 750ms, then at the end inside the loop
+        0x00, 0xFF, 0x2F, 0x00  // end of track
+    };
+
+    struct null_device : midi_device {
+        [[nodiscard]] bool is_open() const noexcept override { return true; }
+        [[nodiscard]] constexpr bool input_available() const noexcept override { return false; }
+        [[nodiscard]] constexpr bool output_available() const noexcept override { return true; }
+        bool open() override { return true; }
+        bool close() override { return true; }
+        std::expected<void, const char*> send_msg(std::span<const uint8_t> /*unused*/) noexcept override { return {}; }
+    };
+
+    struct rendered {
+        std::chrono::nanoseconds time;
+        midi_device*             device;
+        uint8_t                  status;
+        uint8_t                  data;
+    };
+}
+
+int main()
+{
+    using namespace std::chrono_literals;
+    using group = track_playhead_group<span_track_index, void>;
+
+    const span_track_index held{span_track{held_notes}};
+    const span_track_index shorter{span_track{short_notes}};
+    null_device            synth;
+
+    group player;
+    auto* playhead = player.add_playhead(std::make_unique<group::Playhead>("held"));
+    playhead->set_track(&held);
+    playhead->set_division(96_ppq);
+    playhead->set_device(&synth);
+    playhead = player.add_playhead(std::make_unique<group::Playhead>("short"));
+    playhead->set_track(&shorter);
+    playhead->set_division(96_ppq);
+
+    std::vector<rendered> log;
+    auto sink = [&log](std::chrono::nanoseconds time, midi_device* device, message_ref msg) {
+        log.push_back({time, device, msg[0], msg.size() > 1 ? msg[1] : uint8_t{}});
+    };
+
+    int failed = 0;
+    player.set_loop(400ms, 1200ms);
+    failed += check(player.loop() && player.loop()->start == 400ms && player.loop()->end == 1200ms, "loop region");
+    try {
+        player.render_offline(sink);
+        failed += check(false, "looping needs until");
+    } catch (const std::invalid_argument&) {
+    }
+
+    player.render_offline(sink, 3000ms);
+    const std::array<rendered, 21> expected{{
+        {0ms, &synth, 0xC0, 0x05},
+        {250ms, nullptr, 0x91, 0x24},
+        {500ms, &synth, 0x90, 0x3C},
+        {750ms, nullptr, 0x81, 0x24}, // the short track ends, it is kept
+        {1000ms, &synth, 0x80, 0x3C},
+        {1000ms, &synth, 0x90, 0x3E},
+        {1200ms, &synth, 0x80, 0x3E}, // restart: held note released, then chased
+        {1200ms, &synth, 0xC0, 0x05},
+        {1300ms, &synth, 0x90, 0x3C}, // 500ms again
+        {1550ms, nullptr, 0x81, 0x24},
+        {1800ms, &synth, 0x80, 0x3C},
+        {1800ms, &synth, 0x90, 0x3E},
+        {2000ms, &synth, 0x80, 0x3E},
+        {2000ms, &synth, 0xC0, 0x05},
+        {2100ms, &synth, 0x90, 0x3C},
+        {2350ms, nullptr, 0x81, 0x24},
+        {2600ms, &synth, 0x80, 0x3C},
+        {2600ms, &synth, 0x90, 0x3E},
+        {2800ms, &synth, 0x80, 0x3E},
+        {2800ms, &synth, 0xC0, 0x05},
+        {2900ms, &synth, 0x90, 0x3C},
+    }};
+    failed += check(log.size() == expected.size(), "event count");
+    for (size_t i = 0; i < std::min(log.size(), expected.size()); ++i) {
+        failed += check(log[i].time == expected[i].time && log[i].device == expected[i].device && log[i].status == expected[i].status && log[i].data == expected[i].data, "event");
+    }
+    failed += check(player.base_time() == 600ms, "position in the loop");
+    failed += check(player.playheads().size() == 2, "ended playheads are kept");
+
+    player.clear_loop();
+    log.clear();
+    player.render_offline(sink);
+    failed += check(log.size() == 4 && log.front().time == 750ms && log.back().time == 1500ms, "plays to the end after clear_loop");
+    failed += check(player.empty(), "finished playheads are removed");
+    return failed;
+}
@@ -0,0 +1,73 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "mfmidi/midi_active_notes.hpp"
+
+#include "test_utility.hpp"
+
+#include <initializer_list>
+#include <vector>
+
+using namespace mfmidi;
+
+namespace {
+    using message = std::vector<uint8_t>;
+
+    std::vector<message> emitted(const active_note_map& notes)
+    {
+        std::vector<message> result;
+        notes.emit([&](std::span<const uint8_t> msg) { result.emplace_back(msg.begin(), msg.end()); });
+        return result;
+    }
+}
+
+int main()
+{
+    active_note_map notes;
+    for (const message& msg : std::initializer_list<message>{
+             {0x90, 0x3C, 0x40}, // on
+             {0x90, 0x40, 0x40}, // on, then off by velocity 0
+             {0x90, 0x40, 0x00},
+             {0x91, 0x7F, 0x40}, // on, channel 2, high half
+             {0x82, 0x10, 0x40}, // off of a note not on
+             {0x93, 0x43, 0x40}, // on, then off
+             {0x83, 0x43, 0x40},
+             {0xB0, 0x3C, 0x00}, // controller, ignored
+             {0xFF, 0x2F, 0x00}, // meta, ignored
+             {0xC0, 0x05},       // program, ignored
+         }) {
+        notes.process(msg);
+    }
+
+    int failed = check(notes.count() == 2, "count");
+    failed += check(notes.test(0, 0x3C) && notes.test(1, 0x7F) && !notes.test(0, 0x40), "test");
+
+    const std::vector<message> expected{
+        {0x80, 0x3C, 0x40},
+        {0x81, 0x7F, 0x40},
+    };
+    failed += check(emitted(notes) == expected, "note offs");
+
+    active_note_map other;
+    other.process(message{0x9F, 0x00, 0x01});
+    notes.merge(other);
+    failed += check(notes.count() == 3 && notes.test(15, 0x00), "merge");
+
+    notes.clear();
+    failed += check(notes.empty() && emitted(notes).empty(), "clear");
+    return failed;
+}
@@ -0,0 +1,99 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "mfmidi/midi_chase.hpp"
+#include "mfmidi/smf/span_track.hpp"
+
+#include "test_utility.hpp"
+
+#include <array>
+#include <initializer_list>
+#include <vector>
+
+using namespace mfmidi;
+
+namespace {
+    using message = std::vector<uint8_t>;
+
+    constexpr std::array<uint8_t, 27> gm_track_data{
+        'M', 'T', 'r', 'k', 0, 0, 0, 19,
+        0x00, 0xB0, 0x07, 0x50,                         // volume
+        0x10, 0xF0, 0x05, 0x7E, 0x7F, 0x09, 0x01, 0xF7, // GM system on, SMF sysex with its length
+        0x10, 0xC1, 0x05,                               // program on channel 2
+        0x00, 0xFF, 0x2F, 0x00                          // end of track
+    };
+
+    std::vector<message> emitted(const chase_state& state)
+    {
+        std::vector<message> result;
+        state.emit([&](std::span<const uint8_t> msg) { result.emplace_back(msg.begin(), msg.end()); });
+        return result;
+    }
+}
+
+int main()
+{
+    chase_state first;
+    for (const message& msg : std::initializer_list<message>{
+             {0x90, 0x3C, 0x40},             // ignored
+             {0xB0, 0x07, 0x50},             // volume
+             {0xC0, 0x05},                   // program
+             {0xB0, 0x00, 0x01},             // bank msb, after program
+             {0xB0, 0x65, 0x00},             // RPN 0: pitch bend range
+             {0xB0, 0x64, 0x00},
+             {0xB0, 0x06, 0x0C},             // 12 semitones
+             {0xB0, 0x65, 0x7F},             // deselect
+             {0xB0, 0x64, 0x7F},
+             {0xE0, 0x00, 0x50},             // bend
+             {0xB0, 0x07, 0x64},             // volume again
+             {0xD1, 0x20},                   // pressure on channel 2
+         }) {
+        first.process(msg, 10);
+    }
+
+    const std::vector<message> expected{
+        {0xB0, 0x00, 0x01},
+        {0xC0, 0x05},
+        {0xB0, 0x07, 0x64},
+        {0xB0, 0x65, 0x00},
+        {0xB0, 0x64, 0x00},
+        {0xB0, 0x06, 0x0C},
+        {0xB0, 0x65, 0x7F},
+        {0xB0, 0x64, 0x7F},
+        {0xE0, 0x00, 0x50},
+        {0xD1, 0x20},
+    };
+    int failed = check(emitted(first) == expected, "emitted messages");
+
+    chase_state second;
+    second.process(message{0xB0, 0x07, 0x10}, 5);  // older than first
+    second.process(message{0xC0, 0x06}, 20);        // newer than first
+    first.merge(second);
+    failed += check(first[0].status.controllers[7] == 0x64, "merge keeps later controller");
+    failed += check(first[0].status.program == 0x06, "merge takes later program");
+
+    first.process(message{0xB0, 0x79, 0x00}, 30); // reset all controllers
+    failed += check(first[0].status.pitchbend == 0 && first[0].status.controllers[11] == 0x7F, "reset all controllers");
+    first.process(message{0xF0, 0x7E, 0x7F, 0x09, 0x01, 0xF7}, 40); // GM system on
+    failed += check(emitted(first).empty(), "GM system on");
+
+    const span_track gm_track{gm_track_data};
+    chase_state      from_track;
+    from_track.process(gm_track.begin(), gm_track.end());
+    failed += check(emitted(from_track) == std::vector<message>{{0xC1, 0x05}}, "GM system on in a track");
+    return failed;
+}
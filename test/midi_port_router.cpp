@@ -0,0 +1,138 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "mfmidi/midi_port_router.hpp"
+#include "mfmidi/smf/span_track_index.hpp"
+#include "mfmidi/track_player.hpp"
+
+#include "test_utility.hpp"
+
+#include <array>
+#include <vector>
+
+using namespace mfmidi;
+
+namespace {
+    constexpr std::array<uint8_t, 34> ported_notes{
+        'M', 'T', 'r', 'k', 0, 0, 0, 26,
+        0x00, 0xFF, 0x21, 0x01, 0x01, // port 1
+        0x60, 0x90, 0x3C, 0x40,       // tick 96
+        0x00, 0x91, 0x3C, 0x40,       // channel 2
+        0x00, 0xFF, 0x21, 0x01, 0x02, // port 2, not routed
+        0x60, 0x90, 0x3E, 0x40,       // tick 192
+        0x00, 0xFF, 0x2F, 0x00        // end of track
+    };
+
+    constexpr std::array<uint8_t, 34> ported_controllers{
+        'M', 'T', 'r', 'k', 0, 0, 0, 26,
+        0x00, 0xFF, 0x21, 0x01, 0x01, // port 1
+        0x00, 0xB0, 0x07, 0x50,       // volume on port 1
+        0x00, 0xFF, 0x21, 0x01, 0x02, // port 2
+        0x00, 0xB0, 0x0A, 0x20,       // pan on port 2
+        0x60, 0x90, 0x3C, 0x40,       // tick 96
+        0x00, 0xFF, 0x2F, 0x00        // end of track
+    };
+
+    struct null_device : midi_device {
+        [[nodiscard]] bool is_open() const noexcept override { return true; }
+        [[nodiscard]] constexpr bool input_available() const noexcept override { return false; }
+        [[nodiscard]] constexpr bool output_available() const noexcept override { return true; }
+        bool open() override { return true; }
+        bool close() override { return true; }
+        std::expected<void, const char*> send_msg(std::span<const uint8_t> /*unused*/) noexcept override { return {}; }
+    };
+
+    struct recording_device : null_device {
+        std::vector<std::vector<uint8_t>> sent;
+
+        std::expected<void, const char*> send_msg(std::span<const uint8_t> msg) noexcept override
+        {
+            sent.emplace_back(msg.begin(), msg.end());
+            return {};
+        }
+    };
+
+    struct rendered {
+        midi_device* device;
+        uint8_t      status;
+        uint8_t      note;
+    };
+}
+
+int main()
+{
+    using namespace std::chrono_literals;
+    using group = track_playhead_group<span_track_index, void>;
+
+    null_device port_one;
+    null_device channel_two;
+    null_device fallback;
+
+    port_router router;
+    router.set_port(1, &port_one, false);
+    router.set_channel(1, 1, &channel_two, false);
+
+    const uint8_t note_on[]{0x90, 0x3C, 0x40};
+    int failed = check(router.device(no_output_port, note_on, &fallback) == &fallback, "no port");
+    failed += check(router.device(1, note_on, &fallback) == &port_one, "port");
+    failed += check(router.device(7, note_on, &fallback) == &fallback, "unrouted port");
+
+    router.set_port(3, &fallback);
+    router.set_port(4, &fallback);
+    failed += check(router.port_device(3) != &fallback && router.port_device(3) == router.port_device(4), "one queue per device");
+
+    const span_track_index track{span_track{ported_notes}};
+    group                  player;
+    auto*                  playhead = player.add_playhead(std::make_unique<group::Playhead>("ported"));
+    playhead->set_track(&track);
+    playhead->set_division(96_ppq);
+    playhead->set_device(&fallback);
+    player.set_router(&router);
+
+    std::vector<rendered> log;
+    player.render_offline([&log](std::chrono::nanoseconds /*unused*/, midi_device* device, message_ref msg) {
+        if ((msg[0] & 0xF0U) == 0x90) {
+            log.push_back({device, msg[0], msg[1]});
+        }
+    });
+    const std::array<rendered, 3> expected{{
+        {&port_one, 0x90, 0x3C},
+        {&channel_two, 0x91, 0x3C},
+        {&fallback, 0x90, 0x3E},
+    }};
+    failed += check(log.size() == expected.size(), "event count");
+    for (size_t i = 0; i < std::min(log.size(), expected.size()); ++i) {
+        failed += check(log[i].device == expected[i].device && log[i].status == expected[i].status && log[i].note == expected[i].note, "routed device");
+    }
+
+    recording_device first_port;
+    recording_device second_port;
+    port_router      split;
+    split.set_port(1, &first_port, false);
+    split.set_port(2, &second_port, false);
+
+    const span_track_index controllers{span_track{ported_controllers}};
+    group                  chased;
+    playhead = chased.add_playhead(std::make_unique<group::Playhead>("controllers"));
+    playhead->set_track(&controllers);
+    playhead->set_division(96_ppq);
+    playhead->set_device(&fallback);
+    chased.set_router(&split);
+    chased.seek(300ms); // chases
+    failed += check(first_port.sent == std::vector<std::vector<uint8_t>>{{0xB0, 0x07, 0x50}}, "chased on the port of the controller");
+    failed += check(second_port.sent == std::vector<std::vector<uint8_t>>{{0xB0, 0x0A, 0x20}}, "chased on the port after the port change");
+    return failed;
+}
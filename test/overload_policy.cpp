@@ -0,0 +1,114 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "mfmidi/playback_clock.hpp"
+#include "mfmidi/smf/span_track_index.hpp"
+#include "mfmidi/track_player.hpp"
+
+#include "test_utility.hpp"
+
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace mfmidi;
+
+namespace {
+    constexpr std::array<uint8_t, 39> mixed_events{
+        'M', 'T', 'r', 'k', 0, 0, 0, 31,
+        0x00, 0xFF, 0x51, 0x03, 0x07, 0xA1, 0x20, // tempo 120 bpm
+        0x00, 0xB0, 0x07, 0x64,                   // volume
+        0x60, 0x90, 0x3C, 0x64,                   // loud note on
+        0x00, 0x90, 0x40, 0x10,                   // soft note on
+        0x60, 0x80, 0x3C, 0x40,
+        0x00, 0x80, 0x40, 0x40,
+        0x00, 0xFF, 0x2F, 0x00 // end of track
+    };
+
+    /// \brief Virtual time, every wakeup is \c lateness after its deadline
+    class late_clock final : public playback_clock {
+        std::atomic<Time::rep> _now{};
+        Time                   _lateness;
+
+    public:
+        explicit late_clock(Time lateness) noexcept
+            : _lateness(lateness)
+        {
+        }
+
+        [[nodiscard]] Time now() noexcept override
+        {
+            return Time{_now.load()};
+        }
+
+        void sleep_until(Time deadline) noexcept override
+        {
+            _now.store(std::max(_now.load(), (deadline + _lateness).count()));
+        }
+    };
+
+    struct recording_device : midi_device {
+        std::vector<std::vector<uint8_t>> sent;
+
+        [[nodiscard]] bool is_open() const noexcept override { return true; }
+        [[nodiscard]] constexpr bool input_available() const noexcept override { return false; }
+        [[nodiscard]] constexpr bool output_available() const noexcept override { return true; }
+        bool open() override { return true; }
+        bool close() override { return true; }
+        std::expected<void, const char*> send_msg(std::span<const uint8_t> msg) noexcept override
+        {
+            sent.emplace_back(msg.begin(), msg.end());
+            return {};
+        }
+    };
+}
+
+int main()
+{
+    using namespace std::chrono_literals;
+    using group = track_playhead_group<span_track_index, void>;
+
+    const span_track_index track{span_track{mixed_events}};
+    late_clock             clock{30ms};
+    recording_device       synth;
+
+    group player;
+    auto* playhead = player.add_playhead(std::make_unique<group::Playhead>("mixed"));
+    playhead->set_track(&track);
+    playhead->set_division(96_ppq);
+    playhead->set_device(&synth);
+    player.set_clock(clock);
+    player.set_release_notes_on_stop(false);
+    player.set_overload_policy(group::overload_policy{}); // 20ms threshold, soft notes are dropped
+
+    player.play();
+    for (int waited = 0; player.playing() && waited < 5000; ++waited) {
+        std::this_thread::sleep_for(1ms);
+    }
+
+    int failed = check(!player.playing(), "played to the end");
+    failed += check(player.skipped_events() == 2, "soft note on and off are counted");
+    const std::vector<std::vector<uint8_t>> expected{
+        {0xFF, 0x51, 0x03, 0x07, 0xA1, 0x20},
+        {0xB0, 0x07, 0x64},
+        {0x90, 0x3C, 0x64},
+        {0x80, 0x3C, 0x40},
+    };
+    failed += check(synth.sent == expected, "tempo, controller and loud note pass, the soft note pair is dropped");
+    return failed;
+}
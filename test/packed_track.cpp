@@ -0,0 +1,96 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "mfmidi/smf/packed_track.hpp"
+#include "mfmidi/smf/span_track_index.hpp"
+#include "mfmidi/track_player.hpp"
+
+#include "test_utility.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <vector>
+
+using namespace mfmidi;
+
+namespace {
+    constexpr std::array<uint8_t, 41> track_data{
+        'M', 'T', 'r', 'k', 0, 0, 0, 33,
+        0x00, 0x90, 0x3C, 0x40,                         // note on
+        0x60, 0x3C, 0x00,                               // running status, tick 96
+        0x00, 0xFF, 0x51, 0x03, 0x0F, 0x42, 0x40,       // tempo 60 bpm
+        0x30, 0xC0, 0x05,                               // program change, tick 144
+        0x00, 0xF0, 0x05, 0x7E, 0x7F, 0x09, 0x01, 0xF7, // sysex, GM system on
+        0x60, 0x90, 0x3E, 0x40,                         // tick 240
+        0x00, 0xFF, 0x2F, 0x00                          // end of track, not yielded
+    };
+
+    struct rendered {
+        std::chrono::nanoseconds time;
+        std::vector<uint8_t>     bytes;
+
+        friend bool operator==(const rendered&, const rendered&) = default;
+    };
+
+    template <class Track>
+    std::vector<rendered> render(const Track& track)
+    {
+        track_playhead_group<Track, void> player;
+        auto* playhead = player.add_playhead(std::make_unique<typename track_playhead_group<Track, void>::Playhead>("packed"));
+        playhead->set_track(&track);
+        playhead->set_division(96_ppq);
+
+        std::vector<rendered> log;
+        player.render_offline([&log](std::chrono::nanoseconds time, midi_device* /*unused*/, message_ref msg) {
+            log.push_back({time, {msg.begin(), msg.end()}});
+        });
+        return log;
+    }
+}
+
+int main()
+{
+    const span_track   track{track_data};
+    const packed_track packed{track};
+
+    std::vector<std::vector<uint8_t>> expected;
+    std::vector<uint32_t>             deltas;
+    for (auto&& msg : track) {
+        expected.emplace_back(msg.begin(), msg.end());
+        deltas.push_back(msg.delta_time());
+    }
+
+    int failed = check(packed.size() == expected.size(), "size");
+    for (size_t i = 0; i < std::min(packed.size(), expected.size()); ++i) {
+        failed += check(std::ranges::equal(packed[i], expected[i]), "message");
+        failed += check(packed[i].delta_time() == deltas[i] && packed.deltas()[i] == deltas[i], "delta time");
+    }
+    failed += check(std::ranges::equal(packed.ticks(), std::array<uint64_t, 6>{0, 96, 96, 144, 144, 240}), "ticks");
+
+    failed += check(std::ranges::equal(packed.payload(2), expected[2]), "meta payload");
+    failed += check(std::ranges::equal(packed.payload(4), expected[4]), "sysex payload");
+    failed += check(packed.payload(0).empty() && packed.payload(3).empty(), "channel messages have no payload");
+
+    failed += check(packed.lower_bound(96).index() == 1, "lower_bound exact");
+    failed += check(packed.lower_bound(100).index() == 3 && packed.lower_bound(100).tick() == 144, "lower_bound between");
+    failed += check(packed.lower_bound(1000) == packed.end(), "lower_bound past end");
+
+    const span_track_index indexed{track};
+    const auto             played = render(packed);
+    failed += check(!played.empty() && played == render(indexed), "plays like span_track");
+    return failed;
+}
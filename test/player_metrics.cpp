@@ -0,0 +1,60 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "mfmidi/player_metrics.hpp"
+
+#include "test_utility.hpp"
+
+#include <cstdio>
+
+using namespace mfmidi;
+using namespace std::chrono_literals;
+
+int main()
+{
+    int failed = 0;
+    for (size_t bucket = 0; bucket + 1 < duration_histogram::bucket_count; ++bucket) {
+        const auto lower = duration_histogram::lower_bound(bucket);
+        const auto upper = duration_histogram::lower_bound(bucket + 1);
+        if (duration_histogram::bucket_of(lower) != bucket || duration_histogram::bucket_of(upper - 1ns) != bucket || upper - lower > lower / 4 + 1ns) {
+            std::fprintf(stderr, "bucket %zu: [%lld, %lld)\n", bucket, static_cast<long long>(lower.count()), static_cast<long long>(upper.count()));
+            failed += check(false, "bucket bounds");
+        }
+    }
+    failed += check(duration_histogram::bucket_of(-5ns) == 0, "negative duration");
+    failed += check(duration_histogram::bucket_of(1h) == duration_histogram::bucket_count - 1, "overflow bucket");
+
+    duration_histogram histogram;
+    failed += check(histogram.quantile(0.5) == 0ns, "empty quantile");
+    for (int i = 0; i < 99; ++i) {
+        histogram.record(100us);
+    }
+    histogram.record(10ms);
+    failed += check(histogram.total() == 100, "total");
+    failed += check(histogram.quantile(0.5) > 100us && histogram.quantile(0.5) <= 125us, "median");
+    failed += check(histogram.quantile(1) > 10ms && histogram.quantile(1) <= 12500us, "max");
+
+    player_metrics metrics;
+    metrics.record_wakeup(2ms);
+    metrics.record_wakeup(-1us);
+    metrics.record_send(3, 50us);
+    failed += check(metrics.wakeups == 2 && metrics.max_lateness == 2'000'000 && metrics.undersleep.total() == 1, "wakeups");
+    failed += check(metrics.events == 3 && metrics.max_batch == 3 && metrics.send_time_total == 50'000, "sends");
+    metrics.reset();
+    failed += check(metrics.wakeups == 0 && metrics.oversleep.total() == 0, "reset");
+    return failed;
+}
@@ -0,0 +1,110 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "mfmidi/smf/span_track_index.hpp"
+#include "mfmidi/track_player.hpp"
+
+#include "test_utility.hpp"
+
+#include <array>
+#include <vector>
+
+using namespace mfmidi;
+
+namespace {
+    constexpr std::array<uint8_t, 24> quarter_notes{
+        'M', 'T', 'r', 'k', 0, 0, 0, 16,
+        0x60, 0x90, 0x3C, 0x40, // tick 96
+        0x60, 0x90, 0x3E, 0x40, // tick 192
+        0x60, 0x90, 0x40, 0x40, // tick 288
+        0x00, 0xFF, 0x2F, 0x00  // end of track
+    };
+
+    constexpr std::array<uint8_t, 24> eighth_notes{
+        'M', 'T', 'r', 'k', 0, 0, 0, 16,
+        0x30, 0x91, 0x24, 0x40, // tick 48
+        0x30, 0x91, 0x26, 0x40, // tick 96
+        0x30, 0x91, 0x28, 0x40, // tick 144
+        0x00, 0xFF, 0x2F, 0x00  // end of track
+    };
+
+    constexpr std::array<uint8_t, 18> long_rest{
+        'M', 'T', 'r', 'k', 0, 0, 0, 10,
+        0x87, 0x84, 0x00, 0x90, 0x3C, 0x40, // tick 115200, 10 minutes at 120 bpm
+        0x00, 0xFF, 0x2F, 0x00              // end of track
+    };
+
+    struct rendered {
+        std::chrono::nanoseconds time;
+        uint8_t                  status;
+        uint8_t                  note;
+    };
+}
+
+int main()
+{
+    using namespace std::chrono_literals;
+    using group = track_playhead_group<span_track_index, void>;
+
+    const span_track_index quarters{span_track{quarter_notes}};
+    const span_track_index eighths{span_track{eighth_notes}};
+
+    group player;
+    for (const auto* track : {&quarters, &eighths}) {
+        auto* playhead = player.add_playhead(std::make_unique<group::Playhead>("render"));
+        playhead->set_track(track);
+        playhead->set_division(96_ppq);
+    }
+
+    std::vector<rendered> log;
+    auto sink = [&log](std::chrono::nanoseconds time, midi_device* /*unused*/, message_ref msg) {
+        log.push_back({time, msg[0], msg.size() > 1 ? msg[1] : uint8_t{}});
+    };
+
+    int failed = 0;
+    player.render_offline(sink, 400ms);
+    failed += check(log.size() == 1, "stops at until");
+    failed += check(player.base_time() == 400ms, "position after until");
+
+    player.render_offline(sink);
+    const std::array<rendered, 6> expected{{
+        {250ms, 0x91, 0x24},
+        {500ms, 0x90, 0x3C}, // same time, in playhead order
+        {500ms, 0x91, 0x26},
+        {750ms, 0x91, 0x28},
+        {1000ms, 0x90, 0x3E},
+        {1500ms, 0x90, 0x40},
+    }};
+    failed += check(log.size() == expected.size(), "event count");
+    for (size_t i = 0; i < std::min(log.size(), expected.size()); ++i) {
+        failed += check(log[i].time == expected[i].time && log[i].status == expected[i].status && log[i].note == expected[i].note, "event");
+    }
+    failed += check(player.empty(), "finished playheads are removed");
+
+    // the rest of a 10 minute sleep is rescaled to the slowest tempo
+    const span_track_index rest{span_track{long_rest}};
+    group                  slow;
+    auto*                  playhead = slow.add_playhead(std::make_unique<group::Playhead>("rest"));
+    playhead->set_track(&rest);
+    playhead->set_division(96_ppq);
+    log.clear();
+    slow.render_offline(sink, 1ms);
+    slow.set_tempo(tempo::from_mspq(0xFFFFFF));
+    slow.render_offline(sink);
+    failed += check(log.size() == 1 && log.front().time == std::chrono::nanoseconds{20'132'625'445'570}, "long sleep retimed without overflow");
+    return failed;
+}
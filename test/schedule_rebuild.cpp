@@ -0,0 +1,136 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "mfmidi/playback_clock.hpp"
+#include "mfmidi/smf/span_track_index.hpp"
+#include "mfmidi/track_player.hpp"
+
+#include "test_utility.hpp"
+
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace mfmidi;
+
+namespace {
+    constexpr std::array<uint8_t, 21> late_note{
+        'M', 'T', 'r', 'k', 0, 0, 0, 13,
+        0x81, 0x40, 0x90, 0x3C, 0x40, // 1000ms
+        0x60, 0x80, 0x3C, 0x40,       // 1500ms
+        0x00, 0xFF, 0x2F, 0x00        // end of track
+    };
+
+    /// \brief Virtual time moved by the test, sleeping blocks until it reaches the deadline
+    class step_clock final : public playback_clock {
+        std::atomic<Time::rep> _now{};
+        std::atomic<Time::rep> _waiting{-1};
+
+    public:
+        [[nodiscard]] Time now() noexcept override
+        {
+            return Time{_now.load()};
+        }
+
+        void sleep_until(Time deadline) noexcept override
+        {
+            if (_now.load() >= deadline.count()) {
+                return;
+            }
+            _waiting.store(deadline.count());
+            while (_now.load() < deadline.count()) {
+                std::this_thread::sleep_for(std::chrono::microseconds{100});
+            }
+            _waiting.store(-1);
+        }
+
+        void set(Time time) noexcept
+        {
+            _now.store(time.count());
+        }
+
+        /// \brief Wait until the player sleeps until \a deadline
+        bool wait_sleeping(Time deadline) const noexcept
+        {
+            for (int waited = 0; waited < 5000; ++waited) {
+                if (_waiting.load() == deadline.count()) {
+                    return true;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds{1});
+            }
+            return false;
+        }
+    };
+
+    struct recording_device : midi_device {
+        step_clock*                           clock = nullptr;
+        std::vector<std::chrono::nanoseconds> sent; // clock time of every message
+
+        [[nodiscard]] bool is_open() const noexcept override { return true; }
+        [[nodiscard]] constexpr bool input_available() const noexcept override { return false; }
+        [[nodiscard]] constexpr bool output_available() const noexcept override { return true; }
+        bool open() override { return true; }
+        bool close() override { return true; }
+        std::expected<void, const char*> send_msg(std::span<const uint8_t> /*unused*/) noexcept override
+        {
+            sent.push_back(clock->now());
+            return {};
+        }
+    };
+}
+
+int main()
+{
+    using namespace std::chrono_literals;
+    using group = track_playhead_group<span_track_index, void>;
+
+    const span_track_index track{span_track{late_note}};
+    step_clock             clock;
+    recording_device       synth;
+    synth.clock = &clock;
+
+    group player;
+    auto* playhead = player.add_playhead(std::make_unique<group::Playhead>("existing"));
+    playhead->set_track(&track);
+    playhead->set_division(96_ppq);
+    playhead->set_device(&synth);
+    player.set_clock(clock);
+    player.set_command_latency(500ms);
+    player.set_release_notes_on_stop(false);
+
+    int failed = 0;
+    player.play();
+    failed += check(clock.wait_sleeping(500ms), "sleeps a command latency before the note");
+
+    // applied halfway through the sleep to the note
+    player.post([&track](group& g) {
+        auto* added = g.add_playhead(std::make_unique<group::Playhead>("added"));
+        added->set_track(&track);
+        added->set_division(96_ppq);
+    });
+    clock.set(500ms);
+    failed += check(clock.wait_sleeping(1000ms), "sleeps until the note");
+    failed += check(player.playheads().size() == 2, "playhead added");
+    clock.set(1000ms);
+    failed += check(clock.wait_sleeping(1500ms), "sleeps until the note off");
+    failed += check(synth.sent.size() == 1 && synth.sent.front() == 1000ms, "the next event of the existing playhead keeps its time");
+
+    player.pause();
+    clock.set(1h); // let the player thread leave the clock
+    return failed;
+}
@@ -0,0 +1,74 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "mfmidi/smf/span_track_index.hpp"
+
+#include "test_utility.hpp"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+using namespace mfmidi;
+
+namespace {
+    constexpr std::array<uint8_t, 37> track_data{
+        'M', 'T', 'r', 'k', 0, 0, 0, 29,
+        0x00, 0x90, 0x3C, 0x40,             // note on
+        0x10, 0x3C, 0x00,                   // running status
+        0x81, 0x00, 0xFF, 0x51, 0x03, 0x07, 0xA1, 0x20, // tempo, delta 128
+        0x05, 0xB0, 0x07, 0x64,             // volume
+        0x00, 0x3E, 0x40,                   // running status control change
+        0x00, 0xC0, 0x05,                   // program change
+        0x00, 0xFF, 0x2F, 0x00              // end of track
+    };
+}
+
+int main()
+{
+    const span_track track{track_data};
+
+    std::vector<std::vector<uint8_t>> expected;
+    std::vector<uint64_t>             ticks;
+    uint64_t                          tick = 0;
+    for (auto&& msg : track) {
+        tick += msg.delta_time();
+        expected.emplace_back(msg.begin(), msg.end());
+        ticks.push_back(tick);
+    }
+
+    int failed = 0;
+    for (size_t stride : {1, 2, 3, 100}) {
+        const span_track_index index{track, stride};
+        failed += check(index.size() == expected.size(), "size");
+        for (size_t i = 0; i < index.size(); ++i) {
+            auto it  = index.begin() + static_cast<std::ptrdiff_t>(i);
+            auto msg = *it;
+            failed += check(std::ranges::equal(msg, expected[i]), "random access message");
+            failed += check(it.tick() == ticks[i], "random access tick");
+        }
+        auto it = index.end();
+        for (size_t i = index.size(); i-- > 0;) {
+            --it;
+            failed += check(std::ranges::equal(*it, expected[i]), "decrement");
+        }
+        failed += check(index.begin()[1].base().inlined(), "running status message is stored inline");
+        failed += check(index.lower_bound(100).tick() == 144, "lower_bound");
+        failed += check(index.lower_bound(1000) == index.end(), "lower_bound past end");
+    }
+    return failed;
+}
@@ -0,0 +1,55 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "mfmidi/smf/span_track.hpp"
+#include "mfmidi/smf/tempo_map.hpp"
+
+#include "test_utility.hpp"
+
+#include <array>
+
+using namespace mfmidi;
+
+namespace {
+    constexpr std::array<uint8_t, 31> track_data{
+        'M', 'T', 'r', 'k', 0, 0, 0, 23,
+        0x00, 0xFF, 0x51, 0x03, 0x07, 0xA1, 0x20, // 120 bpm
+        0x81, 0x40, 0xFF, 0x51, 0x03, 0x0F, 0x42, 0x40, // 60 bpm at tick 192
+        0x60, 0x90, 0x3C, 0x40,                   // note on at tick 288
+        0x00, 0xFF, 0x2F, 0x00                    // end of track
+    };
+}
+
+int main()
+{
+    using namespace std::chrono_literals;
+    const auto map = tempo_map::from_track(96_ppq, span_track{track_data});
+
+    int failed = 0;
+    failed += check(map.segments().size() == 2, "segments");
+    failed += check(map.tick_to_time(96) == 500ms, "tick_to_time in first segment");
+    failed += check(map.tick_to_time(288) == 2s, "tick_to_time in second segment");
+    failed += check(map.time_to_tick(1500ms) == 240, "time_to_tick");
+    failed += check(map.time_to_tick(-1s) == 0, "time_to_tick before start");
+    failed += check(map.tempo_at(191).mspq() == 500000 && map.tempo_at(192).mspq() == 1000000, "tempo_at");
+
+    auto cursor = map.make_cursor();
+    for (uint64_t tick : {0, 10, 191, 192, 500, 100, 1000}) {
+        failed += check(cursor.tick_to_time(tick) == map.tick_to_time(tick), "cursor");
+    }
+    return failed;
+}
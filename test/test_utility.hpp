@@ -0,0 +1,34 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/// \file test_utility.hpp
+/// \brief Helpers shared by the tests
+
+#pragma once
+
+#include <cstdio>
+
+/// \brief Report \a what if \a cond is false
+/// \return 1 if failed, sum them as the exit code
+inline int check(bool cond, const char* what)
+{
+    if (!cond) {
+        std::fprintf(stderr, "failed: %s\n", what);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,60 @@
+/*
+ * This file is a part of libmfmidi.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "mfmidi/smf/variable_number.hpp"
+
+#include "test_utility.hpp"
+
+#include <iterator>
+#include <random>
+#include <vector>
+
+int main()
+{
+    std::mt19937                       rng{42};
+    std::vector<uint32_t>              values;
+    std::vector<uint8_t>               stream;
+    std::uniform_int_distribution<int> kind{0, 9};
+    for (int i = 0; i < 10000; ++i) {
+        // mostly single byte numbers, like delta times
+        const int      k   = kind(rng);
+        const uint32_t max = k < 7 ? 0x7F : k < 8 ? 0x3FFF : k < 9 ? 0x1FFFFF : 0x0FFFFFFF;
+        values.push_back(std::uniform_int_distribution<uint32_t>{0, max}(rng));
+        mfmidi::writeVarNumIt(values.back(), std::back_inserter(stream));
+    }
+
+    int            failed = 0;
+    const uint8_t* ptr    = stream.data();
+    for (uint32_t value : values) {
+        auto result = mfmidi::read_smf_variable_length_number(ptr, stream.data() + stream.size());
+        auto slow   = mfmidi::read_smf_variable_length_number(std::ranges::subrange{ptr, stream.data() + stream.size()});
+        if (check(result.result == value && slow.result == value && result.it == slow.it && result.size == slow.size, "word decode matches byte decode") != 0) {
+            return 1;
+        }
+        ptr = result.it;
+    }
+
+    const uint8_t four_bytes[]{0xFF, 0xFF, 0xFF, 0x7F};
+    failed += check(mfmidi::read_smf_variable_length_number(std::begin(four_bytes), std::end(four_bytes)).result == 0x0FFFFFFF, "4 byte number");
+
+    const uint8_t too_long[]{0x81, 0x80, 0x80, 0x80, 0x00, 0, 0, 0};
+    try {
+        (void)mfmidi::read_smf_variable_length_number(std::begin(too_long), std::end(too_long));
+        failed += check(false, "5 byte number rejected");
+    } catch (const std::range_error&) {
+    }
+    return failed;
+}